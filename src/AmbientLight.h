@@ -0,0 +1,281 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        AmbientLight.h
+//
+// Description:
+//
+//   Ambient-light adaptive brightness.  The ESP32-S3's ADC runs in continuous
+//   (DMA) mode on the light sensor pin; a background task blocks on the DMA
+//   frames, filters them and publishes a target brightness that the render
+//   loop picks up with a single load.  Nothing in loop() touches the ADC.
+//
+//   AmbientFilter and the brightness curve are plain integer code with no
+//   hardware dependencies, so the same filter can be driven from a synthetic
+//   sensor to measure its latency and stability (see RunAmbientStepTest).
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "globals.h"
+#include <array>
+#include <atomic>
+#include <driver/adc.h>
+
+// AmbientFilter
+//
+// Smooths the raw 12-bit readings.  Each DMA frame is reduced to its mean,
+// the mean is run through an exponential moving average, and the resulting
+// brightness only moves when it changes by more than a small hysteresis so
+// that sensor noise can't make the strip shimmer.
+
+class AmbientFilter
+{
+    static constexpr uint32_t SmoothingShift  = 3; // EMA weight 1/8 per block
+    static constexpr uint8_t  HysteresisSteps = 4; // Brightness counts to ignore
+
+    uint32_t _levelQ8    = 0; // Filtered level, 24.8 fixed point
+    bool     _primed     = false;
+    uint8_t  _brightness = 0;
+
+public:
+    struct CurvePoint
+    {
+        uint16_t level;      // Filtered ADC reading
+        uint8_t  brightness; // Strip brightness at that level
+    };
+
+    // Brightness curve, piecewise linear between points: dim at night, full
+    // in daylight.
+
+    static constexpr std::array<CurvePoint, 5> Curve = {{
+        {0, 48},
+        {200, 64},
+        {800, 128},
+        {2000, 220},
+        {4095, 255},
+    }};
+
+    static uint8_t BrightnessForLevel(uint16_t level)
+    {
+        if (level <= Curve.front().level)
+            return Curve.front().brightness;
+
+        for (size_t i = 1; i < Curve.size(); i++)
+        {
+            if (level <= Curve[i].level)
+            {
+                const CurvePoint& lo = Curve[i - 1];
+                const CurvePoint& hi = Curve[i];
+                return lo.brightness + (int32_t)(hi.brightness - lo.brightness) *
+                                           (level - lo.level) / (hi.level - lo.level);
+            }
+        }
+        return Curve.back().brightness;
+    }
+
+    // Feeds the mean of one block of samples; returns the brightness to use.
+
+    uint8_t AddBlock(uint16_t mean)
+    {
+        if (!_primed)
+        {
+            _levelQ8    = mean << 8;
+            _brightness = BrightnessForLevel(mean);
+            _primed     = true;
+        }
+
+        _levelQ8 += ((int32_t)(mean << 8) - (int32_t)_levelQ8) >> SmoothingShift;
+
+        const uint8_t target = BrightnessForLevel(_levelQ8 >> 8);
+        if (abs(target - _brightness) > HysteresisSteps || target == Curve.front().brightness ||
+            target == Curve.back().brightness)
+            _brightness = target;
+
+        return _brightness;
+    }
+
+    uint16_t GetLevel() const { return _levelQ8 >> 8; }
+    uint8_t  GetBrightness() const { return _brightness; }
+};
+
+// AmbientLight
+//
+// Owns the continuous ADC and the task that drains it.
+
+class AmbientLight
+{
+public:
+    static constexpr uint32_t SampleRateHz  = 1000;
+    static constexpr uint32_t BlockSamples  = 64; // ~64 ms per DMA frame
+    static constexpr uint32_t BytesPerBlock = BlockSamples * SOC_ADC_DIGI_RESULT_BYTES;
+
+private:
+    adc1_channel_t        _channel;
+    AmbientFilter         _filter;
+    std::atomic<uint8_t>  _brightness;
+    std::atomic<uint16_t> _level{0};
+    bool                  _running = false;
+
+    static void TaskEntry(void* pv) { static_cast<AmbientLight*>(pv)->Run(); }
+
+    void Run()
+    {
+        uint8_t buffer[BytesPerBlock];
+
+        for (;;)
+        {
+            uint32_t length = 0;
+            if (adc_digi_read_bytes(buffer, sizeof(buffer), &length, ADC_MAX_DELAY) != ESP_OK)
+                continue;
+
+            uint32_t total = 0;
+            uint32_t count = 0;
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length;
+                 i += SOC_ADC_DIGI_RESULT_BYTES)
+            {
+                const auto* result = reinterpret_cast<const adc_digi_output_data_t*>(&buffer[i]);
+                if (result->type2.channel != _channel)
+                    continue;
+                total += result->type2.data;
+                count++;
+            }
+
+            if (count)
+            {
+                _brightness = _filter.AddBlock(total / count);
+                _level      = _filter.GetLevel();
+            }
+        }
+    }
+
+public:
+    AmbientLight(adc1_channel_t channel, uint8_t initialBrightness)
+        : _channel(channel), _brightness(initialBrightness)
+    {
+    }
+
+    // Begin
+    //
+    // Configures the ADC for continuous DMA sampling of our one channel and
+    // starts the filter task.  Returns false if the ADC driver refused.
+
+    bool Begin(uint8_t core)
+    {
+        adc_digi_init_config_t initConfig = {};
+        initConfig.max_store_buf_size     = BytesPerBlock * 4;
+        initConfig.conv_num_each_intr     = BytesPerBlock;
+        initConfig.adc1_chan_mask         = BIT(_channel);
+        initConfig.adc2_chan_mask         = 0;
+        if (adc_digi_initialize(&initConfig) != ESP_OK)
+            return false;
+
+        adc_digi_pattern_config_t pattern = {};
+        pattern.atten                     = ADC_ATTEN_DB_11;
+        pattern.channel                   = _channel;
+        pattern.unit                      = 0; // ADC1
+        pattern.bit_width                 = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+        adc_digi_configuration_t config = {};
+        config.conv_limit_en            = false;
+        config.sample_freq_hz           = SampleRateHz;
+        config.conv_mode                = ADC_CONV_SINGLE_UNIT_1;
+        config.format                   = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+        config.pattern_num              = 1;
+        config.adc_pattern              = &pattern;
+        if (adc_digi_controller_configure(&config) != ESP_OK)
+            return false;
+
+        Resume();
+        return xTaskCreateUniversal(TaskEntry, "ambientLoop", 2048 + BytesPerBlock, this, 1,
+                                    nullptr, core) == pdPASS;
+    }
+
+    // Stop and restart sampling around light sleep
+
+    void Suspend()
+    {
+        if (_running)
+            adc_digi_stop();
+        _running = false;
+    }
+
+    void Resume()
+    {
+        if (!_running)
+            adc_digi_start();
+        _running = true;
+    }
+
+    uint8_t  GetBrightness() const { return _brightness.load(std::memory_order_relaxed); }
+    uint16_t GetLevel() const { return _level.load(std::memory_order_relaxed); }
+};
+
+// RunAmbientStepTest
+//
+// Drives a fresh AmbientFilter from a simulated sensor instead of the ADC:
+// darkness, then a step to bright light, each block's samples jittered by
+// +/- noise.  Reports how quickly the brightness follows the step and how
+// often it moves once the light is steady - use it to check any change to
+// the filter constants above.
+
+struct AmbientStepResult
+{
+    uint8_t  startBrightness = 0; // Settled brightness before the step
+    uint8_t  endBrightness   = 0; // Settled brightness after the step
+    uint32_t rise10Ms        = 0; // Step to 10% of the way there
+    uint32_t rise90Ms        = 0; // Step to 90% of the way there
+    uint32_t steadyChanges   = 0; // Brightness changes in the settled second half of each phase
+};
+
+inline AmbientStepResult RunAmbientStepTest(uint16_t darkLevel, uint16_t brightLevel, uint16_t noise,
+                                            uint32_t seed = 1)
+{
+    constexpr uint32_t BlockMs     = AmbientLight::BlockSamples * 1000 / AmbientLight::SampleRateHz;
+    constexpr uint32_t PhaseBlocks = 8000 / BlockMs; // Eight seconds each side of the step
+
+    AmbientFilter     filter;
+    AmbientStepResult result;
+    std::array<uint8_t, PhaseBlocks> after{};
+    uint8_t           previous = 0;
+
+    for (uint32_t block = 0; block < PhaseBlocks * 2; block++)
+    {
+        const uint16_t level = block < PhaseBlocks ? darkLevel : brightLevel;
+
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < AmbientLight::BlockSamples; i++)
+        {
+            seed ^= seed << 13; // xorshift32
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            const int32_t sample = level + (int32_t)(seed % (2 * noise + 1)) - noise;
+            total += constrain(sample, 0, 4095);
+        }
+
+        const uint8_t brightness = filter.AddBlock(total / AmbientLight::BlockSamples);
+        const bool    settled    = block % PhaseBlocks >= PhaseBlocks / 2;
+        if (block > 0 && settled && brightness != previous)
+            result.steadyChanges++;
+        previous = brightness;
+
+        if (block < PhaseBlocks)
+            result.startBrightness = brightness;
+        else
+            after[block - PhaseBlocks] = result.endBrightness = brightness;
+    }
+
+    const int32_t span = result.endBrightness - result.startBrightness;
+    for (uint32_t i = 0; i < PhaseBlocks && span; i++)
+    {
+        const int32_t moved = (after[i] - result.startBrightness) * 100 / span;
+        if (!result.rise10Ms && moved >= 10)
+            result.rise10Ms = (i + 1) * BlockMs;
+        if (!result.rise90Ms && moved >= 90)
+            result.rise90Ms = (i + 1) * BlockMs;
+    }
+    return result;
+}
@@ -0,0 +1,273 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        CanInput.h
+//
+// Description:
+//
+//   Vehicle CAN bus as an input source.  Instead of inferring the brake from
+//   both turn-bulb circuits (and waiting out their debounce), brake, turn
+//   and reverse state are read straight from the frames the vehicle already
+//   broadcasts, through the ESP32-S3's TWAI controller.
+//
+//   CanDecoder is plain code with no hardware dependencies: it maps frame
+//   bits to InputSignals and reports changes, and can encode frames too, so
+//   a simulated bus can be pushed through exactly the same decode path.
+//   CanInputSource is the InputSource that frames are fed into, and
+//   CanInput adds the TWAI driver; it is only built with ENABLE_CAN_INPUT.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "InputSource.h"
+#include <algorithm>
+#include <array>
+
+#ifndef ENABLE_CAN_INPUT
+#define ENABLE_CAN_INPUT 0
+#endif
+
+#if ENABLE_CAN_INPUT
+#include <driver/twai.h>
+#endif
+
+struct CanFrame
+{
+    uint32_t                id     = 0; // Standard 11-bit identifier
+    uint8_t                 length = 0; // Data bytes present
+    std::array<uint8_t, 8> data{};
+};
+
+// Where one signal lives: a bit (or bits) of one data byte of one frame
+
+struct CanSignalMap
+{
+    uint16_t    id;
+    uint8_t     byte;
+    uint8_t     mask; // Signal is asserted when any of these bits is set
+    InputSignal signal;
+};
+
+// CanDecoder
+//
+// Turns frames into signal changes using a table of CanSignalMap entries.
+// Only changes are reported, so a vehicle repeating the same status frame
+// every 10 ms costs a compare per entry and nothing more.
+
+template <size_t N> class CanDecoder
+{
+    const std::array<CanSignalMap, N>& _map;
+    uint8_t                            _state = 0; // SignalBit set while the signal is asserted
+
+public:
+    explicit CanDecoder(const std::array<CanSignalMap, N>& map) : _map(map) {}
+
+    // Decode
+    //
+    // Calls changed(signal, asserted) for each signal in the frame that
+    // differs from the last frame seen.
+
+    template <typename Changed> void Decode(const CanFrame& frame, Changed changed)
+    {
+        for (const auto& entry : _map)
+        {
+            if (entry.id != frame.id || entry.byte >= frame.length)
+                continue;
+
+            const uint8_t bit      = SignalBit(entry.signal);
+            const bool    asserted = frame.data[entry.byte] & entry.mask;
+            if (asserted == bool(_state & bit))
+                continue;
+
+            _state ^= bit;
+            changed(entry.signal, asserted);
+        }
+    }
+
+    // Encode
+    //
+    // Builds the frame with the given id that carries the signals in
+    // signalMask (SignalBits), for simulating a vehicle.
+
+    CanFrame Encode(uint16_t id, uint8_t signalMask) const
+    {
+        CanFrame frame;
+        frame.id = id;
+
+        for (const auto& entry : _map)
+        {
+            if (entry.id != id)
+                continue;
+            frame.length = max<uint8_t>(frame.length, entry.byte + 1);
+            if (signalMask & SignalBit(entry.signal))
+                frame.data[entry.byte] |= entry.mask;
+        }
+        return frame;
+    }
+
+    // AcceptanceCode / AcceptanceMask
+    //
+    // Single-filter settings for the TWAI controller that pass every frame id
+    // in the map.  Identifier bits that differ between the ids become don't
+    // cares, so with several ids a few unrelated frames may get through;
+    // Decode() ignores those.  RTR and data bits are always don't cares.
+
+    uint32_t AcceptanceCode() const { return static_cast<uint32_t>(_map[0].id) << 21; }
+
+    uint32_t AcceptanceMask() const
+    {
+        uint32_t differ = 0;
+        for (const auto& entry : _map)
+            differ |= entry.id ^ _map[0].id;
+        return (differ << 21) | 0x001FFFFF;
+    }
+
+    uint8_t GetState() const { return _state; }
+
+    uint8_t Provides() const
+    {
+        uint8_t mask = 0;
+        for (const auto& entry : _map)
+            mask |= SignalBit(entry.signal);
+        return mask;
+    }
+};
+
+// CanInputSource
+//
+// Signals decoded from the frames handed to OnFrame(), by the receive task
+// or by a simulation.  Decoded signals need no debounce, so a change is
+// reported on the very next poll.
+
+template <size_t N> class CanInputSource : public InputSource
+{
+    CanDecoder<N>                          _decoder;
+    uint8_t                                _state = 0; // Decoder state as of the last frame
+    std::array<uint32_t, InputSignalCount> _changeMs{};
+    std::array<uint32_t, InputSignalCount> _changes{};
+    bool                                   _resync = true;
+    portMUX_TYPE                           _mux    = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    explicit CanInputSource(const std::array<CanSignalMap, N>& map) : _decoder(map) {}
+
+    // OnFrame
+    //
+    // Called from one task only, since the decoder isn't locked.
+
+    void OnFrame(const CanFrame& frame)
+    {
+        _decoder.Decode(frame, [this](InputSignal signal, bool asserted)
+        {
+            const size_t  i   = static_cast<size_t>(signal);
+            const uint8_t bit = SignalBit(signal);
+
+            portENTER_CRITICAL(&_mux);
+            _state = asserted ? _state | bit : _state & ~bit;
+            _changeMs[i] = LightingMillis();
+            _changes[i]++;
+            portEXIT_CRITICAL(&_mux);
+        });
+    }
+
+    const CanDecoder<N>& GetDecoder() const { return _decoder; }
+
+    uint8_t Provides() const override { return _decoder.Provides(); }
+
+    void Poll(InputUpdate& update) override
+    {
+        portENTER_CRITICAL(&_mux);
+        const uint8_t                                state    = _state;
+        const std::array<uint32_t, InputSignalCount> changeMs = _changeMs;
+        portEXIT_CRITICAL(&_mux);
+
+        const uint8_t  provides = Provides();
+        const uint32_t now      = LightingMillis();
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (provides & (1 << i))
+                Report(update, static_cast<InputSignal>(i), state & (1 << i),
+                       _resync ? now : changeMs[i], _resync);
+
+        _resync = false;
+    }
+
+    void Resync() override { _resync = true; }
+
+    uint32_t GetEventCount(InputSignal signal) const override
+    {
+        return _changes[static_cast<size_t>(signal)];
+    }
+};
+
+#if ENABLE_CAN_INPUT
+
+// CanInput
+//
+// Listen-only TWAI receiver.  The driver's RX interrupt queues each frame
+// that passes the hardware filter, and a high-priority task blocked on that
+// queue decodes it at once, so a brake frame is waiting for the render loop
+// well inside the next frame period.
+
+template <size_t N> class CanInput : public CanInputSource<N>
+{
+    uint32_t _frames = 0; // Frames received that passed the filter
+
+    static void TaskEntry(void* pv) { static_cast<CanInput*>(pv)->Run(); }
+
+    void Run()
+    {
+        twai_message_t message;
+
+        for (;;)
+        {
+            if (twai_receive(&message, portMAX_DELAY) != ESP_OK || message.extd || message.rtr)
+                continue;
+
+            CanFrame frame;
+            frame.id     = message.identifier;
+            frame.length = min<uint8_t>(message.data_length_code, frame.data.size());
+            std::copy_n(message.data, frame.length, frame.data.begin());
+
+            _frames++;
+            this->OnFrame(frame);
+        }
+    }
+
+public:
+    using CanInputSource<N>::CanInputSource;
+
+    // Begin
+    //
+    // Installs and starts the TWAI driver at 500 kbit/s in listen-only mode,
+    // so we never drive the vehicle's bus, not even to acknowledge.  Returns
+    // false if the driver refused.
+
+    bool Begin(uint8_t txPin, uint8_t rxPin, uint8_t core)
+    {
+        twai_general_config_t general = TWAI_GENERAL_CONFIG_DEFAULT(
+            static_cast<gpio_num_t>(txPin), static_cast<gpio_num_t>(rxPin), TWAI_MODE_LISTEN_ONLY);
+        general.rx_queue_len = 32;
+
+        const twai_timing_config_t timing = TWAI_TIMING_CONFIG_500KBITS();
+
+        twai_filter_config_t filter = {};
+        filter.acceptance_code      = this->GetDecoder().AcceptanceCode();
+        filter.acceptance_mask      = this->GetDecoder().AcceptanceMask();
+        filter.single_filter        = true;
+
+        if (twai_driver_install(&general, &timing, &filter) != ESP_OK)
+            return false;
+        if (twai_start() != ESP_OK)
+            return false;
+
+        return xTaskCreateUniversal(TaskEntry, "canLoop", 3072, this, configMAX_PRIORITIES - 2,
+                                    nullptr, core) == pdPASS;
+    }
+
+    uint32_t GetFrameCount() const { return _frames; }
+};
+
+#endif // ENABLE_CAN_INPUT
@@ -0,0 +1,568 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        ClockSync.h
+//
+// Description:
+//
+//   Frame and phase sync between controllers that share a wired sync line,
+//   such as one at each end of a trailer.  The master raises the line at
+//   every multiple of SyncPeriodUs on its own clock, so each rising edge is
+//   a timestamp: lighting time is exactly a whole number of periods there.
+//   Followers capture the edge time in an IRQ and steer their lighting clock
+//   (LightingMillis) onto the master's, so strobes, flash cycles and chases
+//   started by the same input stay in step instead of drifting apart by the
+//   difference in crystal error.
+//
+//   The edge doesn't say which multiple it is, so a follower's clock agrees
+//   with the master's modulo the period.  Nothing lit depends on more than
+//   that: effects measure time from their own start, and the brake strobe's
+//   80 ms cycle divides the period.
+//
+//   Lighting time never runs backwards.  The brake inference, the strobe,
+//   the turn signal cycle and the debounce all subtract one LightingMillis()
+//   from a later one, so a follower corrects its clock by slewing the rate,
+//   and only steps it, always forward, while nothing is lit and no input has
+//   arrived for a while.  A stray pulse on the line, or a master that
+//   rebooted onto a new phase, can't move the clock on one edge: an edge
+//   must land where the edges before it say it should, and a new phase is
+//   only taken up after several edges agree on it.
+//
+//   ClockDiscipline is plain code with no hardware dependencies, so the
+//   simulation below runs it against virtual nodes on the board or a host.
+//   ClockSync adds the pin, IRQ and master timer; it is only built with
+//   ENABLE_CLOCK_SYNC.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Telemetry.h"
+#include "globals.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#ifndef ENABLE_CLOCK_SYNC
+#define ENABLE_CLOCK_SYNC 0
+#endif
+
+#if ENABLE_CLOCK_SYNC
+#include <driver/gpio.h>
+#endif
+
+static constexpr uint32_t SyncPeriodUs = 400000; // A multiple of the brake strobe's 80 ms cycle
+
+// ClockDiscipline
+//
+// A phase-locked loop on the sync edges.  Each edge should land on a whole
+// period of lighting time; the distance to the nearest one is the error.
+// Rather than jumping the clock, which would run debounce timers and effect
+// cycles backwards, the error is slewed out over the next few periods by
+// adjusting the rate, and a slowly integrated share of it becomes the
+// frequency correction that cancels the crystal difference.
+//
+// Edges are gated: once locked, an edge only counts if it lands a whole
+// number of periods after the last one, give or take GateUs.  Anything else
+// is noise unless LockEdges in a row agree on a grid of their own, which is
+// how the first lock and a master restart look.  Errors over
+// StepThresholdUs are then stepped out if the caller says it's safe, and
+// slewed out at up to MaxSlewQ32 otherwise.
+
+class ClockDiscipline
+{
+public:
+    static constexpr int64_t  StepThresholdUs = 5000;                      // Larger errors are stepped
+    static constexpr int64_t  GateUs          = 2000;                      // Edge timing tolerance
+    static constexpr int64_t  MaxFrequencyQ32 = (500LL << 32) / 1000000;   // +/- 500 ppm
+    static constexpr int64_t  MaxSlewQ32      = (50000LL << 32) / 1000000; // +/- 5%
+    static constexpr int      PhaseShift      = 1; // Half the error is slewed out per period
+    static constexpr int      FrequencyShift  = 4; // A sixteenth is folded into the frequency
+    static constexpr int      LostPeriods     = 3; // Edges missed before we call it unlocked
+    static constexpr uint32_t LockEdges       = 3; // Edges that must agree on a new phase
+
+private:
+    const int64_t    _periodUs;
+    LightingClockMap _map;                 // Local to lighting time; identity until locked
+    int64_t          _frequencyQ32   = 0;  // Crystal correction, without the phase slew
+    int64_t          _lastEdgeUs     = 0;  // Local time of the last edge
+    int64_t          _lastErrorUs    = 0;
+    int64_t          _candidateUs    = 0;  // Local time of the last edge off the locked grid
+    uint32_t         _candidates     = 0;  // Edges in a row on the candidate's grid
+    uint32_t         _edges          = 0;
+    uint32_t         _rejected       = 0;
+    uint32_t         _steps          = 0;
+    bool             _locked         = false;
+
+    int64_t RoundToPeriod(int64_t us) const
+    {
+        const int64_t periods = (us + _periodUs / 2) / _periodUs;
+        return periods * _periodUs;
+    }
+
+    // Whether localUs is 1 to LostPeriods whole periods after fromUs, give
+    // or take GateUs.  The crystals are close enough that a few periods of
+    // local time are a few periods of the master's.
+
+    bool OnGrid(int64_t fromUs, int64_t localUs) const
+    {
+        const int64_t gapUs   = localUs - fromUs;
+        const int64_t periods = (gapUs + _periodUs / 2) / _periodUs;
+        return periods >= 1 && periods <= LostPeriods && std::abs(gapUs - periods * _periodUs) <= GateUs;
+    }
+
+public:
+    explicit ClockDiscipline(uint32_t periodUs = SyncPeriodUs) : _periodUs(periodUs) {}
+
+    int64_t ToSynced(int64_t localUs) const { return MapLightingClock(_map, localUs); }
+
+    // Observe
+    //
+    // Feeds the local time of one sync edge, in order.  canStep says whether
+    // the clock may jump: the caller passes false while anything is lit or
+    // being debounced.  Returns true if the clock was stepped.
+
+    bool Observe(int64_t localUs, bool canStep)
+    {
+        _edges++;
+
+        if (_locked && OnGrid(_lastEdgeUs, localUs))
+        {
+            _candidates = 0;
+        }
+        else
+        {
+            _candidates  = _candidates && OnGrid(_candidateUs, localUs) ? _candidates + 1 : 1;
+            _candidateUs = localUs;
+            if (_candidates < LockEdges)
+            {
+                _rejected++;
+                return false;
+            }
+            _candidates = 0;
+            _locked     = true;
+        }
+
+        const int64_t predictedUs = ToSynced(localUs);
+        const int64_t errorUs     = RoundToPeriod(predictedUs) - predictedUs;
+
+        _lastErrorUs = errorUs;
+        _lastEdgeUs  = localUs;
+
+        // The clocks only have to agree modulo the period, so a step back is
+        // made as a step forward by the rest of the period instead.  While
+        // stepping isn't allowed the rate takes up to MaxSlewQ32 of the
+        // error, no more than it takes to clear it by the next edge.
+
+        if (std::abs(errorUs) > StepThresholdUs)
+        {
+            if (canStep)
+            {
+                _map = { localUs, predictedUs + (errorUs < 0 ? errorUs + _periodUs : errorUs), _frequencyQ32 };
+                _steps++;
+                return true;
+            }
+
+            const int64_t errorQ32 = (errorUs << 32) / _periodUs;
+            _map = { localUs, predictedUs, _frequencyQ32 + std::clamp(errorQ32, -MaxSlewQ32, MaxSlewQ32) };
+            return false;
+        }
+
+        const int64_t errorQ32 = (errorUs << 32) / _periodUs;
+        _frequencyQ32 = std::clamp(_frequencyQ32 + (errorQ32 >> FrequencyShift), -MaxFrequencyQ32, MaxFrequencyQ32);
+        _map          = { localUs, predictedUs, _frequencyQ32 + (errorQ32 >> PhaseShift) };
+        return false;
+    }
+
+    // Holdover
+    //
+    // Called while no edges are arriving.  Once the line has been quiet for
+    // a while, re-anchors the map at localUs with the phase slew dropped so
+    // the clock free-runs at the last frequency (and the map arithmetic never
+    // sees an elapsed time long enough to overflow).  Returns true if the map
+    // changed.
+
+    bool Holdover(int64_t localUs)
+    {
+        if (!_locked || localUs - _map.refLocalUs < LostPeriods * _periodUs)
+            return false;
+
+        _map = { localUs, ToSynced(localUs), _frequencyQ32 };
+        return true;
+    }
+
+    bool IsLocked(int64_t localUs) const { return _locked && localUs - _lastEdgeUs < LostPeriods * _periodUs; }
+
+    const LightingClockMap& GetMap() const { return _map; }
+    int64_t  GetLastErrorUs() const { return _lastErrorUs; }
+    float    GetFrequencyPpm() const { return _frequencyQ32 * 1e6f / 4294967296.0f; }
+    uint32_t GetEdgeCount() const { return _edges; }
+    uint32_t GetRejectedCount() const { return _rejected; }
+    uint32_t GetStepCount() const { return _steps; }
+};
+
+// ClockSyncScenario
+//
+// What SimulateClockSync puts the followers through.
+
+struct ClockSyncScenario
+{
+    size_t   nodes          = 4;
+    uint32_t seconds        = 600;
+    float    ppm            = 50.0f; // Each follower's crystal error is within +/- this
+    uint32_t jitterUs       = 30;    // Timer and IRQ latency, up to this on every edge
+    uint32_t noisePerMinute = 0;     // Stray pulses on the sync line
+    uint32_t restartAtS     = 0;     // When the master reboots onto a new phase; 0 for never
+    uint32_t busyPercent    = 0;     // Chance that a node has something lit in a given period
+    uint32_t seed           = 1;
+};
+
+struct ClockSyncResult
+{
+    bool     settled        = false; // Every node ended within ToleranceUs and stayed there
+    uint32_t settledMs      = 0;     // When the last one got there, from the restart if any
+    int64_t  worstUs        = 0;     // Worst error of any node once settled
+    float    rmsUs          = 0;
+    int64_t  spreadUs       = 0;     // Widest spread between nodes once all had settled
+    uint32_t steps          = 0;
+    uint32_t stepsWhileBusy = 0;
+    uint32_t backwardSteps  = 0;     // Times a node's lighting clock read less than before
+    uint32_t rejectedEdges  = 0;
+};
+
+// SimulateClockSync
+//
+// Runs a master and scenario.nodes followers on virtual time.  Each
+// follower gets a random crystal error, a random start time, and a random
+// IRQ latency on every edge; the master's edges get their own timer
+// latency.  Stray pulses land between edges, and a restarting master goes
+// quiet for BootUs and comes back on a random phase.  Each follower's
+// lighting clock is read eight times a period, checked against the
+// master's modulo the period, and checked never to go backwards.
+
+inline ClockSyncResult SimulateClockSync(const ClockSyncScenario& scenario)
+{
+    static constexpr int64_t  ToleranceUs    = 1000;
+    static constexpr uint32_t SamplesPerEdge = 8;
+    static constexpr int64_t  BootUs         = 1500000;
+
+    struct Node
+    {
+        ClockDiscipline discipline;
+        double          rate;    // Local seconds per master second
+        int64_t         startUs; // Local time when the master's clock read zero
+        int64_t         settledUs    = -1;
+        int64_t         worstUs      = 0;
+        double          sumSquares   = 0;
+        uint32_t        samples      = 0;
+        int64_t         lastSyncedUs = INT64_MIN;
+        bool            busy         = false;
+    };
+
+    uint32_t state  = scenario.seed ? scenario.seed : 1;
+    auto     random = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    auto uniform = [&random](double low, double high) { return low + (high - low) * (random() / 4294967296.0); };
+
+    std::vector<Node> followers;
+    followers.reserve(scenario.nodes);
+    for (size_t i = 0; i < scenario.nodes; i++)
+        followers.push_back({ ClockDiscipline(SyncPeriodUs), 1.0 + uniform(-scenario.ppm, scenario.ppm) * 1e-6,
+                              static_cast<int64_t>(uniform(0, 10e6)) });
+
+    const int64_t period    = SyncPeriodUs;
+    const int64_t stepUs    = period / SamplesPerEdge;
+    const int64_t endUs     = static_cast<int64_t>(scenario.seconds) * 1000000;
+    const int64_t restartUs = scenario.restartAtS ? scenario.restartAtS * 1000000LL : INT64_MAX;
+    const double  noise     = scenario.noisePerMinute * period / 60e6; // Chance of a pulse per period
+    int64_t       phaseUs   = 0; // Master lighting time less true time
+    bool          restarted = false;
+
+    ClockSyncResult result;
+
+    auto wrap = [period](int64_t us)
+    {
+        us %= period;
+        if (us > period / 2)
+            us -= period;
+        if (us < -period / 2)
+            us += period;
+        return us;
+    };
+
+    auto localTime = [](const Node& node, int64_t us)
+    {
+        return node.startUs + static_cast<int64_t>(us * node.rate);
+    };
+
+    auto read = [&result, &localTime](Node& node, int64_t us)
+    {
+        const int64_t syncedUs = node.discipline.ToSynced(localTime(node, us));
+        if (syncedUs < node.lastSyncedUs)
+            result.backwardSteps++;
+        node.lastSyncedUs = syncedUs;
+        return syncedUs;
+    };
+
+    auto edge = [&](int64_t us)
+    {
+        for (auto& node : followers)
+        {
+            const int64_t captureUs = us + random() % (scenario.jitterUs + 1);
+            read(node, captureUs);
+            if (node.discipline.Observe(localTime(node, captureUs), !node.busy))
+            {
+                result.steps++;
+                result.stepsWhileBusy += node.busy;
+            }
+            read(node, captureUs);
+        }
+    };
+
+    for (int64_t edgeUs = period; edgeUs <= endUs;)
+    {
+        edge(edgeUs + random() % (scenario.jitterUs + 1));
+
+        int64_t nextUs = edgeUs + period;
+        if (!restarted && nextUs >= restartUs)
+        {
+            const int64_t upUs = restartUs + BootUs;
+            restarted = true;
+            phaseUs   = random() % period;
+            nextUs    = upUs + (period - (upUs + phaseUs) % period) % period;
+            for (auto& node : followers)
+            {
+                node.settledUs  = -1;
+                node.worstUs    = 0;
+                node.sumSquares = 0;
+                node.samples    = 0;
+            }
+        }
+
+        for (auto& node : followers)
+            node.busy = random() % 100 < scenario.busyPercent;
+
+        // A stray pulse lands between two of this period's samples
+
+        int64_t noiseUs = INT64_MAX;
+        if (uniform(0, 1) < noise)
+            noiseUs = edgeUs + stepUs * (random() % (SamplesPerEdge - 1)) + stepUs / 2;
+
+        for (int64_t sampleUs = edgeUs + stepUs; sampleUs < nextUs; sampleUs += stepUs)
+        {
+            if (noiseUs < sampleUs)
+            {
+                edge(noiseUs);
+                noiseUs = INT64_MAX;
+            }
+
+            const int64_t masterUs = sampleUs + (sampleUs >= restartUs ? phaseUs : 0);
+            int64_t       low = INT64_MAX, high = INT64_MIN;
+            bool          settled = true;
+
+            for (auto& node : followers)
+            {
+                node.discipline.Holdover(localTime(node, sampleUs));
+                const int64_t errorUs = wrap(read(node, sampleUs) - masterUs);
+
+                if (std::abs(errorUs) >= ToleranceUs)
+                {
+                    node.settledUs  = -1;
+                    node.worstUs    = 0;
+                    node.sumSquares = 0;
+                    node.samples    = 0;
+                }
+                else
+                {
+                    if (node.settledUs < 0)
+                        node.settledUs = sampleUs;
+                    node.worstUs = std::max(node.worstUs, std::abs(errorUs));
+                    node.sumSquares += static_cast<double>(errorUs) * errorUs;
+                    node.samples++;
+                }
+
+                settled = settled && node.settledUs >= 0;
+                low     = std::min(low, errorUs);
+                high    = std::max(high, errorUs);
+            }
+
+            if (!settled)
+                result.spreadUs = 0;
+            else
+                result.spreadUs = std::max(result.spreadUs, high - low);
+        }
+
+        edgeUs = nextUs;
+    }
+
+    double   sumSquares = 0;
+    uint32_t samples    = 0;
+    result.settled      = true;
+    for (const Node& node : followers)
+    {
+        result.settled = result.settled && node.settledUs >= 0;
+        if (node.settledUs >= 0)
+            result.settledMs =
+                std::max<uint32_t>(result.settledMs, (node.settledUs - (restarted ? restartUs : 0)) / 1000);
+        result.worstUs = std::max(result.worstUs, node.worstUs);
+        result.rejectedEdges += node.discipline.GetRejectedCount();
+        sumSquares += node.sumSquares;
+        samples    += node.samples;
+    }
+    result.rmsUs = static_cast<float>(std::sqrt(sumSquares / std::max<uint32_t>(samples, 1)));
+    return result;
+}
+
+
+#if ENABLE_CLOCK_SYNC
+
+enum class ClockSyncRole
+{
+    Master,
+    Follower
+};
+
+// ClockSync
+//
+// As master, an esp_timer started on a whole period toggles the sync line
+// every half period, so rising edges fall on multiples of SyncPeriodUs of
+// our own clock, late only by the timer's dispatch latency.  The master's
+// lighting clock is left alone.
+//
+// As follower, the rising-edge IRQ queues esp_timer time and Service(),
+// called from the render loop, runs every queued edge through the
+// discipline, in order, and publishes the new map for LightingMillis().
+// Queueing them means a stray pulse can't overwrite a real edge before the
+// render loop gets to it.
+
+class ClockSync
+{
+    static constexpr size_t CaptureSlots = 8;
+
+    ClockDiscipline                      _discipline;
+    const uint8_t                        _pin;
+    ClockSyncRole                        _role     = ClockSyncRole::Follower;
+    esp_timer_handle_t                   _timer    = nullptr;
+    bool                                 _level    = false;
+    bool                                 _periodic = false;
+    TelemetryRing<int64_t, CaptureSlots> _captures; // IRQ to render loop
+    std::atomic<uint32_t>                _irqs{0};  // Edges seen, including any dropped
+
+    static void IRAM_ATTR OnEdge(void* arg)
+    {
+        const int64_t now  = esp_timer_get_time();
+        auto*         self = static_cast<ClockSync*>(arg);
+
+        self->_captures.Push(now);
+        self->_irqs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void OnTimer(void* arg)
+    {
+        auto* self = static_cast<ClockSync*>(arg);
+
+        // The first alarm is a one-shot on a whole period; from there the
+        // timer runs every half period
+
+        if (!self->_periodic)
+        {
+            self->_periodic = true;
+            esp_timer_start_periodic(self->_timer, SyncPeriodUs / 2);
+        }
+
+        self->_level = !self->_level;
+        gpio_set_level(static_cast<gpio_num_t>(self->_pin), self->_level);
+    }
+
+    void Publish()
+    {
+        const uint8_t next = g_LightingClockMap.load(std::memory_order_relaxed) ^ 1;
+        g_LightingClockMaps[next] = _discipline.GetMap();
+        g_LightingClockMap.store(next, std::memory_order_release);
+        g_LightingClockSynced = true;
+    }
+
+public:
+    explicit ClockSync(uint8_t pin) : _pin(pin) {}
+
+    // Begin
+    //
+    // Returns false if the master timer couldn't be created.
+
+    bool Begin(ClockSyncRole role)
+    {
+        _role = role;
+
+        if (role == ClockSyncRole::Follower)
+        {
+            pinMode(_pin, INPUT_PULLDOWN);
+            attachInterruptArg(_pin, OnEdge, this, RISING);
+            return true;
+        }
+
+        pinMode(_pin, OUTPUT);
+        digitalWrite(_pin, LOW);
+
+        esp_timer_create_args_t args = {};
+        args.callback                = OnTimer;
+        args.arg                     = this;
+        args.dispatch_method         = ESP_TIMER_TASK;
+        args.name                    = "clockSync";
+        if (esp_timer_create(&args, &_timer) != ESP_OK)
+            return false;
+
+        const int64_t now = esp_timer_get_time();
+        return esp_timer_start_once(_timer, SyncPeriodUs - now % SyncPeriodUs) == ESP_OK;
+    }
+
+    // Service
+    //
+    // Followers only: applies any queued edges.  canStep is passed on to
+    // ClockDiscipline::Observe(); pass false while anything is lit or an
+    // input has changed recently.
+
+    void Service(bool canStep)
+    {
+        if (_role != ClockSyncRole::Follower)
+            return;
+
+        bool    changed = false;
+        int64_t captureUs;
+        while (_captures.Pop(captureUs))
+        {
+            _discipline.Observe(captureUs, canStep);
+            changed = true;
+        }
+
+        if (!changed)
+            changed = _discipline.Holdover(esp_timer_get_time());
+
+        if (changed)
+            Publish();
+    }
+
+    void Print() const
+    {
+        if (_role == ClockSyncRole::Master)
+        {
+            Serial.printf("Clock sync master on GPIO %u, %lu ms edges\n", _pin, (unsigned long)(SyncPeriodUs / 1000));
+            return;
+        }
+
+        Serial.printf("Clock sync follower on GPIO %u: %s, %lu edges (%lu IRQs, %lu rejected), %lu steps, "
+                      "last error %lld us, %+.1f ppm\n",
+                      _pin, _discipline.IsLocked(esp_timer_get_time()) ? "locked" : "not locked",
+                      (unsigned long)_discipline.GetEdgeCount(), (unsigned long)_irqs.load(),
+                      (unsigned long)_discipline.GetRejectedCount(), (unsigned long)_discipline.GetStepCount(),
+                      (long long)_discipline.GetLastErrorUs(), _discipline.GetFrequencyPpm());
+    }
+};
+
+#endif // ENABLE_CLOCK_SYNC
@@ -0,0 +1,250 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        FrameMonitor.h
+//
+// Description:
+//
+//   Frame deadline monitor.  The render loop marks the start of each frame
+//   and of its input, render and show phases; at the end of the frame the
+//   monitor checks it against the frame deadline and the per-phase budgets,
+//   and counts any overrun against the phase that caused it.  The worst
+//   frame seen is kept with its phase breakdown.
+//
+//   The UI, telemetry and other tasks all run on core 0 and the render loop
+//   on core 1, so they never take time from a frame; only interrupts on the
+//   render core do, and that time is counted in whichever phase they land
+//   in.
+//
+//   Another task polls CheckForStall() to catch a frame that never ends.
+//   It gets a snapshot of where the render loop is stuck long before the
+//   task watchdog fires, so the report says which phase hung.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+enum class FramePhase : uint8_t
+{
+    Input = 0,
+    Render,
+    Show,
+    Count
+};
+
+enum class OverrunCause : uint8_t
+{
+    Input = 0,
+    Render,
+    Show,
+    Count
+};
+
+inline constexpr size_t FramePhaseCount   = static_cast<size_t>(FramePhase::Count);
+inline constexpr size_t OverrunCauseCount = static_cast<size_t>(OverrunCause::Count);
+
+struct FrameTiming
+{
+    uint32_t                              frame   = 0; // Frame number
+    uint32_t                              totalUs = 0; // Start of frame to end
+    std::array<uint32_t, FramePhaseCount> phaseUs{};   // Time spent in each phase
+};
+
+// Where the render loop was when a frame ran past the stall limit
+
+struct StallSnapshot
+{
+    uint32_t   frame     = 0;
+    FramePhase phase     = FramePhase::Input;
+    uint32_t   elapsedUs = 0; // Since the start of the frame
+    uint32_t   phaseUs   = 0; // Since the start of the phase it's stuck in
+};
+
+class FrameMonitor
+{
+public:
+    struct Stats
+    {
+        uint32_t                                frames = 0;
+        std::array<uint32_t, OverrunCauseCount> overruns{};
+        FrameTiming                             worst;
+        uint32_t                                stalls = 0;
+        StallSnapshot                           lastStall;
+    };
+
+private:
+    const uint32_t                              _deadlineUs;
+    const std::array<uint32_t, FramePhaseCount> _budgetUs;
+    const uint32_t                              _stallUs;
+
+    // Written by the render loop, read by CheckForStall on another task
+
+    std::atomic<bool>     _inFrame{false};
+    std::atomic<uint32_t> _frame{0};
+    std::atomic<uint32_t> _frameStartUs{0};
+    std::atomic<uint32_t> _phaseStartUs{0};
+    std::atomic<uint8_t>  _phase{0};
+    uint32_t              _stallReported = UINT32_MAX; // Frame the last stall report was for
+
+    FrameTiming  _current;
+    OverrunCause _lastCause = OverrunCause::Count; // Count when the last frame was on time
+
+    Stats        _stats;
+    portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+    void ClosePhase(uint32_t now)
+    {
+        const uint8_t phase = _phase.load(std::memory_order_relaxed);
+        _current.phaseUs[phase] += now - _phaseStartUs.load(std::memory_order_relaxed);
+    }
+
+    // Classify
+    //
+    // The phase furthest over its budget, or failing that the longest phase.
+
+    OverrunCause Classify(const FrameTiming& timing) const
+    {
+        size_t   worstPhase  = 0;
+        uint32_t worstExcess = 0;
+        size_t   bigPhase    = 0;
+
+        for (size_t i = 0; i < FramePhaseCount; i++)
+        {
+            if (timing.phaseUs[i] > _budgetUs[i] && timing.phaseUs[i] - _budgetUs[i] > worstExcess)
+            {
+                worstPhase  = i;
+                worstExcess = timing.phaseUs[i] - _budgetUs[i];
+            }
+            if (timing.phaseUs[i] > timing.phaseUs[bigPhase])
+                bigPhase = i;
+        }
+
+        return static_cast<OverrunCause>(worstExcess ? worstPhase : bigPhase);
+    }
+
+public:
+    FrameMonitor(uint32_t deadlineUs, const std::array<uint32_t, FramePhaseCount>& budgetUs,
+                 uint32_t stallUs)
+        : _deadlineUs(deadlineUs), _budgetUs(budgetUs), _stallUs(stallUs)
+    {
+    }
+
+    // Render loop side
+
+    void BeginFrame(uint32_t frame)
+    {
+        const uint32_t now = micros();
+
+        _current       = FrameTiming();
+        _current.frame = frame;
+
+        _frame.store(frame, std::memory_order_relaxed);
+        _frameStartUs.store(now, std::memory_order_relaxed);
+        _phaseStartUs.store(now, std::memory_order_relaxed);
+        _phase.store(static_cast<uint8_t>(FramePhase::Input), std::memory_order_relaxed);
+        _inFrame.store(true, std::memory_order_release);
+    }
+
+    void BeginPhase(FramePhase phase)
+    {
+        const uint32_t now = micros();
+
+        ClosePhase(now);
+        _phaseStartUs.store(now, std::memory_order_relaxed);
+        _phase.store(static_cast<uint8_t>(phase), std::memory_order_relaxed);
+    }
+
+    // EndFrame
+    //
+    // Closes the frame and checks it against the deadline.  Afterwards
+    // GetLastCause() says why it missed, or is Count if it didn't.
+
+    void EndFrame()
+    {
+        const uint32_t now = micros();
+
+        ClosePhase(now);
+        _current.totalUs = now - _frameStartUs.load(std::memory_order_relaxed);
+        _inFrame.store(false, std::memory_order_release);
+
+        const bool overran = _current.totalUs > _deadlineUs;
+        _lastCause         = overran ? Classify(_current) : OverrunCause::Count;
+
+        portENTER_CRITICAL(&_statsMux);
+        _stats.frames++;
+        if (overran)
+            _stats.overruns[static_cast<size_t>(_lastCause)]++;
+        if (_current.totalUs > _stats.worst.totalUs)
+            _stats.worst = _current;
+        portEXIT_CRITICAL(&_statsMux);
+    }
+
+    OverrunCause       GetLastCause() const { return _lastCause; }
+    const FrameTiming& GetLastFrame() const { return _current; }
+
+    // CheckForStall
+    //
+    // Call periodically from a task other than the render loop.  Returns true,
+    // once per stuck frame, when the frame in progress has run past the stall
+    // limit, and fills in where it's stuck.
+
+    bool CheckForStall(StallSnapshot& snapshot)
+    {
+        if (!_inFrame.load(std::memory_order_acquire))
+            return false;
+
+        const uint32_t now     = micros();
+        const uint32_t frame   = _frame.load(std::memory_order_relaxed);
+        const uint32_t elapsed = now - _frameStartUs.load(std::memory_order_relaxed);
+        if (elapsed < _stallUs || frame == _stallReported)
+            return false;
+
+        snapshot.frame     = frame;
+        snapshot.phase     = static_cast<FramePhase>(_phase.load(std::memory_order_relaxed));
+        snapshot.elapsedUs = elapsed;
+        snapshot.phaseUs   = now - _phaseStartUs.load(std::memory_order_relaxed);
+        _stallReported     = frame;
+
+        portENTER_CRITICAL(&_statsMux);
+        _stats.stalls++;
+        _stats.lastStall = snapshot;
+        portEXIT_CRITICAL(&_statsMux);
+        return true;
+    }
+
+    Stats GetStats()
+    {
+        portENTER_CRITICAL(&_statsMux);
+        const Stats stats = _stats;
+        portEXIT_CRITICAL(&_statsMux);
+        return stats;
+    }
+
+    void Reset()
+    {
+        portENTER_CRITICAL(&_statsMux);
+        _stats = Stats();
+        portEXIT_CRITICAL(&_statsMux);
+    }
+
+    uint32_t GetDeadlineUs() const { return _deadlineUs; }
+    uint32_t GetStallUs() const { return _stallUs; }
+
+    static const char* PhaseName(FramePhase phase)
+    {
+        static constexpr const char* names[] = {"input", "render", "show"};
+        return static_cast<size_t>(phase) < FramePhaseCount ? names[static_cast<size_t>(phase)] : "?";
+    }
+
+    static const char* CauseName(OverrunCause cause)
+    {
+        static constexpr const char* names[] = {"input", "render", "show"};
+        return static_cast<size_t>(cause) < OverrunCauseCount ? names[static_cast<size_t>(cause)] : "?";
+    }
+};
@@ -0,0 +1,138 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        HeapGuard.h
+//
+// Description:
+//
+//   Debug check that the real-time path never touches the heap.  In heap
+//   guard builds the linker routes every malloc/free in the image (ours,
+//   FastLED's, the Heltec library's, newlib's stdio) through wrappers in
+//   main.cpp, which hand each call to HeapGuard.  Calls made from an ISR, or
+//   from the render task while it is inside a HEAP_GUARD_SCOPE, are recorded
+//   with their call site in a fixed ring so that recording never allocates.
+//
+//   Build the heltec_wifi_kit_32_V3_heapguard environment to turn it on; it
+//   sets -DENABLE_HEAP_GUARD=1 and the matching -Wl,--wrap flags.  Otherwise
+//   HEAP_GUARD_SCOPE compiles to nothing.  The native test_heap_guard suite
+//   runs the same check on the host on every test run and fails if a frame
+//   allocates.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+#ifndef ENABLE_HEAP_GUARD
+#define ENABLE_HEAP_GUARD 0
+#endif
+
+#if ENABLE_HEAP_GUARD
+
+struct HeapEvent
+{
+    uint32_t caller; // Return address of the malloc/free call
+    uint32_t size;   // Bytes requested; 0 for a free
+    char     kind;   // 'm'alloc, 'c'alloc, 'r'ealloc or 'f'ree
+    bool     isr;    // Called from interrupt context
+};
+
+// HeapGuard
+//
+// Any task or ISR may call Record(), so a slot is claimed with one atomic
+// increment as in TraceBuffer.  Once the ring is full later events are only
+// counted.
+
+template <size_t N> class HeapGuard
+{
+    std::array<HeapEvent, N>  _events{};
+    std::atomic<uint32_t>     _count{0};
+    std::atomic<TaskHandle_t> _guardedTask{nullptr};
+
+public:
+    // Guard / Unguard
+    //
+    // Bracket the region of the calling task to watch.  Guard returns the
+    // previous state for Unguard to restore, so scopes nest.
+
+    TaskHandle_t Guard() { return _guardedTask.exchange(xTaskGetCurrentTaskHandle()); }
+    void         Unguard(TaskHandle_t previous) { _guardedTask = previous; }
+
+    // Record
+    //
+    // Called by the allocator wrappers for every heap call in the image, so
+    // it has to be cheap in the common case of an unwatched task.
+
+    inline void IRAM_ATTR Record(char kind, size_t size, void* caller)
+    {
+        const bool isr = xPortInIsrContext();
+        if (!isr && _guardedTask.load(std::memory_order_relaxed) != xTaskGetCurrentTaskHandle())
+            return;
+
+        const uint32_t slot = _count.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= N)
+            return;
+
+        // Xtensa keeps the caller's window size in the top two bits of the
+        // return address; put the code segment back and step back to the call.
+
+        HeapEvent& event = _events[slot];
+        event.caller     = ((reinterpret_cast<uintptr_t>(caller) & 0x3FFFFFFF) | 0x40000000) - 3;
+        event.size       = size;
+        event.kind       = kind;
+        event.isr        = isr;
+    }
+
+    uint32_t Count() const { return _count.load(); }
+
+    void Reset() { _count = 0; }
+
+    // Dump
+    //
+    // Writes "@M <kind> <bytes> <isr|task> 0x<caller>" for each recorded call
+    // and a closing verdict.  Feed the addresses to xtensa-esp32s3-elf-addr2line
+    // -pfiaC -e firmware.elf to get the call sites.
+
+    void Dump() const
+    {
+        const uint32_t count = Count();
+
+        Serial.printf("@M begin %lu\n", (unsigned long)count);
+        for (uint32_t i = 0; i < min<uint32_t>(count, N); i++)
+        {
+            const HeapEvent& event = _events[i];
+            Serial.printf("@M %c %lu %s 0x%08lx\n", event.kind, (unsigned long)event.size,
+                          event.isr ? "isr" : "task", (unsigned long)event.caller);
+        }
+        Serial.printf("@M end %s\n", count ? "FAIL" : "PASS");
+    }
+};
+
+// HeapGuardScope
+//
+// Watches the calling task for as long as it's in scope.
+
+template <typename Guard> class HeapGuardScope
+{
+    Guard&       _guard;
+    TaskHandle_t _previous;
+
+public:
+    explicit HeapGuardScope(Guard& guard) : _guard(guard), _previous(guard.Guard()) {}
+    ~HeapGuardScope() { _guard.Unguard(_previous); }
+};
+
+#define HEAP_GUARD_CONCAT_(a, b) a##b
+#define HEAP_GUARD_CONCAT(a, b)  HEAP_GUARD_CONCAT_(a, b)
+#define HEAP_GUARD_SCOPE(guard)  HeapGuardScope<decltype(guard)> HEAP_GUARD_CONCAT(_heapGuardScope, __LINE__)(guard)
+
+#else
+
+#define HEAP_GUARD_SCOPE(guard)
+
+#endif // ENABLE_HEAP_GUARD
@@ -0,0 +1,221 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        InputReplay.h
+//
+// Description:
+//
+//   Record and replay of the raw input edge stream.  The recorder keeps the
+//   most recent edges seen by the input IRQs in a RAM ring so that real
+//   vehicle timing (bulb-sense bounce, left and right edges a few ms apart)
+//   can be exported over serial.  The replayer feeds a captured trace back
+//   through the input debounce (ReplayInputSource) and the frame renderer on
+//   a virtual clock, either in real time or as fast as the CPU allows.
+//
+//   The replayer only depends on globals.h and whatever callbacks it's
+//   handed, so it runs the same way against the recorder's ring on the board
+//   or against a trace of any length on a host: the native environment's
+//   test_input_replay suite replays a three-hour drive through main.cpp, and
+//   loads exported captures back with ParseInputEdge().
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "globals.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+struct InputEdge
+{
+    uint32_t timeUs; // micros() when the IRQ fired
+    uint8_t  pin;    // GPIO that changed
+    uint8_t  level;  // HIGH or LOW, as read by the IRQ
+};
+
+// InputRecorder
+//
+// Ring of the last N edges, always recording.  Record() is called from the
+// input IRQs; when the ring is full the oldest edges are overwritten.
+
+template <size_t N> class InputRecorder
+{
+    static_assert((N & (N - 1)) == 0, "Ring size must be a power of two");
+
+    std::array<InputEdge, N> _edges{};
+    std::atomic<uint32_t>    _count{0}; // Total edges ever recorded
+
+public:
+    inline void Record(uint8_t pin, int level)
+    {
+        const uint32_t slot = _count.fetch_add(1, std::memory_order_relaxed);
+        InputEdge&     edge = _edges[slot & (N - 1)];
+        edge.timeUs         = micros();
+        edge.pin            = pin;
+        edge.level          = level;
+    }
+
+    void Clear() { _count = 0; }
+
+    // Number of edges held, oldest first through operator[]
+
+    size_t size() const { return min<uint32_t>(_count, N); }
+
+    const InputEdge& operator[](size_t i) const
+    {
+        const uint32_t count = _count;
+        const uint32_t first = count > N ? count - N : 0;
+        return _edges[(first + i) & (N - 1)];
+    }
+
+    // Export
+    //
+    // Writes the held edges as "@E <us> <pin> <level>" lines, oldest first.
+
+    void Export() const
+    {
+        const size_t count = size();
+
+        Serial.printf("@E begin %u\n", (unsigned)count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const InputEdge& edge = (*this)[i];
+            Serial.printf("@E %lu %u %u\n", (unsigned long)edge.timeUs, edge.pin, edge.level);
+        }
+        Serial.println("@E end");
+    }
+};
+
+// ParseInputEdge
+//
+// Reads one line of an Export() capture into edge.  Anything before the "@E"
+// is skipped, so lines saved with the serial monitor's timestamps still
+// parse.  Returns false for the begin and end lines, for edges on pins the
+// replay can't represent, and for whatever else was logged in between.
+
+inline bool ParseInputEdge(const char* line, InputEdge& edge)
+{
+    const char* start = strstr(line, "@E ");
+    if (!start)
+        return false;
+
+    unsigned long timeUs;
+    unsigned      pin, level;
+    char          extra;
+    if (sscanf(start, "@E %lu %u %u %c", &timeUs, &pin, &level, &extra) != 3 || pin > 63 ||
+        level > 1)
+        return false;
+
+    edge = {static_cast<uint32_t>(timeUs), static_cast<uint8_t>(pin), static_cast<uint8_t>(level)};
+    return true;
+}
+
+// InputReplayer
+//
+// Drives a trace through the lighting logic.  Virtual time advances one
+// frame period at a time; before each frame every edge that is due is applied
+// to the virtual pin levels and handed to dispatchIRQ(pin), then
+// renderFrame() is called.  renderFrame returns true while anything is still
+// lit.  Once nothing is lit and the last edge is older than SettleMs (so that
+// debouncing has finished), fast replays skip straight over the idle stretch
+// to the next edge, and after the last edge the replay ends.
+
+class InputReplayer
+{
+public:
+    struct Result
+    {
+        uint32_t edges     = 0; // Edges dispatched
+        uint32_t frames    = 0; // Frames rendered
+        uint32_t virtualMs = 0; // Length of the replay on the virtual clock
+        uint32_t wallMs    = 0; // How long it actually took
+    };
+
+    static constexpr uint32_t SettleMs  = 250;  // Quiet time before an unlit strip counts as idle
+    static constexpr uint32_t MaxTailMs = 5000; // Longest we'll run on after the last edge
+
+    template <typename Source, typename DispatchIRQ, typename RenderFrame>
+    static Result Run(const Source& edges, uint32_t framePeriodUs, bool realTime,
+                      DispatchIRQ dispatchIRQ, RenderFrame renderFrame)
+    {
+        Result result;
+        if (edges.size() == 0)
+            return result;
+
+        // Edge times are 32-bit micros() and wrap every ~71 minutes, so we walk
+        // the trace by deltas and keep virtual time in 64 bits.
+
+        const uint32_t wallStartMs = millis();
+        const uint32_t baseMs      = edges[0].timeUs / 1000;
+        uint32_t       prevEdgeUs  = edges[0].timeUs;
+        uint64_t       edgeDueUs   = 0;
+        uint64_t       virtualUs   = 0;
+        uint64_t       lastEdgeUs  = 0;
+        size_t         next        = 0;
+
+        g_ReplayPinLevels   = ~0ULL;
+        g_ReplayMs          = baseMs;
+        g_InputReplayActive = true;
+
+        for (;;)
+        {
+            while (next < edges.size())
+            {
+                const InputEdge& edge  = edges[next];
+                const uint64_t   dueUs = edgeDueUs + (edge.timeUs - prevEdgeUs);
+                if (dueUs > virtualUs)
+                    break;
+
+                edgeDueUs  = dueUs;
+                prevEdgeUs = edge.timeUs;
+                lastEdgeUs = dueUs;
+
+                if (edge.level == LOW)
+                    g_ReplayPinLevels &= ~(1ULL << edge.pin);
+                else
+                    g_ReplayPinLevels |= 1ULL << edge.pin;
+
+                g_ReplayMs = baseMs + dueUs / 1000;
+                dispatchIRQ(edge.pin);
+                result.edges++;
+                next++;
+            }
+
+            g_ReplayMs      = baseMs + virtualUs / 1000;
+            const bool busy = renderFrame();
+            result.frames++;
+
+            if (realTime)
+                while (millis() - wallStartMs < virtualUs / 1000)
+                    delay(1);
+
+            const uint64_t quietUs = virtualUs - lastEdgeUs;
+            const bool     idle    = !busy && quietUs > SettleMs * 1000ULL;
+
+            if (next >= edges.size() && (idle || quietUs > MaxTailMs * 1000ULL))
+                break;
+
+            virtualUs += framePeriodUs;
+
+            // Idle and nothing due for a while: jump ahead to the frame just
+            // before the next edge.
+
+            if (!realTime && idle && next < edges.size())
+            {
+                const uint64_t nextDueUs = edgeDueUs + (edges[next].timeUs - prevEdgeUs);
+                if (nextDueUs > virtualUs + framePeriodUs)
+                    virtualUs = nextDueUs - (nextDueUs - virtualUs) % framePeriodUs;
+            }
+        }
+
+        g_InputReplayActive = false;
+
+        result.virtualMs = virtualUs / 1000;
+        result.wallMs    = millis() - wallStartMs;
+        return result;
+    }
+};
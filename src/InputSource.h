@@ -0,0 +1,537 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        InputSource.h
+//
+// Description:
+//
+//   Where the logical input signals (left, right, brake, reverse, emergency
+//   and the demo button) come from.  The effects don't know about pins any
+//   more; once per frame the render loop polls one InputSource, which brings
+//   an InputUpdate up to date with the state of every signal it provides,
+//   which of them changed and when.  All the effects then work from that one
+//   consistent update, however the signals are wired.
+//
+//   Backends here:
+//
+//     GpioInputSource           One GPIO per signal, edge IRQs, debounced
+//     ReplayInputSource         The same debounce fed from a recorded trace
+//     ShiftRegisterInputSource  74HC165 shift register, one bulk read per poll
+//     SimulatedInputSource      Signals set directly by code
+//
+//   CanInputSource (CanInput.h) is another, and LayeredInputSource puts one
+//   source over another, such as CAN for the vehicle signals over GPIO for
+//   the emergency switch and demo button.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "globals.h"
+#include <array>
+#include <atomic>
+
+enum class InputSignal : uint8_t
+{
+    Left = 0,
+    Right,
+    Brake,
+    Reverse,
+    Emergency,
+    Demo,
+    Count
+};
+
+inline constexpr size_t InputSignalCount = static_cast<size_t>(InputSignal::Count);
+
+constexpr uint8_t SignalBit(InputSignal signal)
+{
+    return 1 << static_cast<uint8_t>(signal);
+}
+
+inline constexpr uint8_t AllInputSignals = (1 << InputSignalCount) - 1;
+
+// InputUpdate
+//
+// The render loop's view of the inputs.  It keeps one across frames, clears
+// changed before each poll, and the source fills in the rest.
+
+struct InputUpdate
+{
+    uint8_t                                asserted = 0; // Bit per InputSignal, set while asserted
+    uint8_t                                changed  = 0; // Signals reported by the latest poll
+    std::array<uint32_t, InputSignalCount> changeMs{};   // LightingMillis() of each signal's latest change
+
+    bool IsAsserted(InputSignal signal) const { return asserted & SignalBit(signal); }
+    bool HasChanged(InputSignal signal) const { return changed & SignalBit(signal); }
+};
+
+// InputSource
+//
+// Poll() is only ever called from the render loop.  Sources that are fed
+// from IRQs or other tasks keep what they've seen under their own lock until
+// then.
+
+class InputSource
+{
+protected:
+    // Report
+    //
+    // Records the state of one signal in the update, marking it changed if
+    // it differs from what the update already had or if force is set and it
+    // is asserted.
+
+    static void Report(InputUpdate& update, InputSignal signal, bool asserted, uint32_t atMs,
+                       bool force = false)
+    {
+        const uint8_t bit = SignalBit(signal);
+        if (asserted == bool(update.asserted & bit) && !(force && asserted))
+            return;
+
+        update.asserted = asserted ? update.asserted | bit : update.asserted & ~bit;
+        update.changed |= bit;
+        update.changeMs[static_cast<size_t>(signal)] = atMs;
+    }
+
+public:
+    virtual ~InputSource() = default;
+
+    // Signals this source has an opinion on, as a SignalBit mask
+    virtual uint8_t Provides() const = 0;
+
+    // Poll
+    //
+    // Brings update up to date with every signal this source provides and
+    // sets their bits in update.changed for those that changed.  Signals the
+    // source doesn't provide are left alone.
+
+    virtual void Poll(InputUpdate& update) = 0;
+
+    // Resync
+    //
+    // Makes the next Poll() report every asserted signal as changed, as at
+    // boot, after waking or after the effects were stopped behind the
+    // source's back, so that held inputs start their effects again.
+
+    virtual void Resync() = 0;
+
+    // Raw events (edges, frames, reads that differed) seen on one signal.
+    // Diagnostic, and any change means there's input activity.
+
+    virtual uint32_t GetEventCount(InputSignal signal) const = 0;
+
+    uint32_t GetTotalEventCount() const
+    {
+        uint32_t total = 0;
+        for (size_t i = 0; i < InputSignalCount; i++)
+            total += GetEventCount(static_cast<InputSignal>(i));
+        return total;
+    }
+};
+
+// EdgeInputSource
+//
+// Active-low inputs, one pin per signal, driven by an edge notification on
+// every change.  An edge only counts once the pin has stayed at the level
+// it read for DebounceMs.  Pins are read with ReadInputPin(), so during a
+// replay they are the virtual ones.
+
+class EdgeInputSource : public InputSource
+{
+public:
+    static constexpr uint32_t DebounceMs = 30;
+
+protected:
+    struct Line
+    {
+        uint8_t               pin           = PIN_NONE;
+        bool                  pending       = false; // Edges seen since the input last settled
+        int                   lastEdgeLevel = HIGH;
+        uint32_t              lastEdgeMs    = 0;
+        std::atomic<uint32_t> edges{0};
+    };
+
+    std::array<Line, InputSignalCount> _lines;
+    portMUX_TYPE                       _mux    = portMUX_INITIALIZER_UNLOCKED;
+    bool                               _resync = true; // First poll reports whatever is held
+
+public:
+    explicit EdgeInputSource(const std::array<uint8_t, InputSignalCount>& pins)
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+            _lines[i].pin = pins[i];
+    }
+
+    // OnEdge
+    //
+    // Called on every edge of the signal's pin, from an IRQ or a replay.
+    // Returns the level it read so that the caller can record the edge.
+
+    int IRAM_ATTR OnEdge(InputSignal signal)
+    {
+        Line& line = _lines[static_cast<size_t>(signal)];
+
+        portENTER_CRITICAL_ISR(&_mux);
+        const int level    = ReadInputPin(line.pin);
+        line.lastEdgeLevel = level;
+        line.lastEdgeMs    = LightingMillis();
+        line.pending       = true;
+        line.edges.fetch_add(1, std::memory_order_relaxed);
+        portEXIT_CRITICAL_ISR(&_mux);
+        return level;
+    }
+
+    // OnPinEdge
+    //
+    // Same, for callers that only know which pin moved.
+
+    void OnPinEdge(uint8_t pin)
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (_lines[i].pin == pin)
+                OnEdge(static_cast<InputSignal>(i));
+    }
+
+    uint8_t Provides() const override
+    {
+        uint8_t mask = 0;
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (_lines[i].pin != PIN_NONE)
+                mask |= 1 << i;
+        return mask;
+    }
+
+    void Poll(InputUpdate& update) override
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+        {
+            Line& line = _lines[i];
+            if (line.pin == PIN_NONE)
+                continue;
+
+            const int current = ReadInputPin(line.pin);
+
+            // Settled once the pin reads the level of its last edge and that
+            // edge is more than DebounceMs old.  The clock is read under the
+            // lock so that an edge can't land after it.
+
+            portENTER_CRITICAL(&_mux);
+            const uint32_t now        = LightingMillis();
+            const uint32_t lastEdgeMs = line.lastEdgeMs;
+            const bool     settled    = line.pending && current == line.lastEdgeLevel &&
+                                        now - lastEdgeMs > DebounceMs;
+            if (settled || _resync)
+                line.pending = false;
+            portEXIT_CRITICAL(&_mux);
+
+            const InputSignal signal = static_cast<InputSignal>(i);
+            if (_resync)
+                Report(update, signal, current == LOW, now, true);
+            else if (settled)
+                Report(update, signal, current == LOW, lastEdgeMs);
+        }
+
+        _resync = false;
+    }
+
+    void Resync() override { _resync = true; }
+
+    uint32_t GetEventCount(InputSignal signal) const override
+    {
+        return _lines[static_cast<size_t>(signal)].edges.load(std::memory_order_relaxed);
+    }
+};
+
+// GpioInputSource
+//
+// EdgeInputSource on real pins with INPUT_PULLUP and a CHANGE interrupt on
+// each.  The optional hook is called from the IRQ with every edge, for
+// recording and tracing.  While a trace is being replayed the real pins are
+// ignored.
+
+class GpioInputSource : public EdgeInputSource
+{
+public:
+    using EdgeHook = void (*)(InputSignal signal, uint8_t pin, int level);
+
+private:
+    struct IRQContext
+    {
+        GpioInputSource* source;
+        InputSignal      signal;
+    };
+
+    std::array<IRQContext, InputSignalCount> _contexts;
+    EdgeHook                                 _hook;
+
+    static void IRAM_ATTR OnInterrupt(void* arg)
+    {
+        if (g_InputReplayActive)
+            return;
+
+        const IRQContext* context = static_cast<const IRQContext*>(arg);
+        GpioInputSource*  source  = context->source;
+        const int         level   = source->OnEdge(context->signal);
+
+        if (source->_hook)
+            source->_hook(context->signal, source->_lines[static_cast<size_t>(context->signal)].pin,
+                          level);
+    }
+
+public:
+    GpioInputSource(const std::array<uint8_t, InputSignalCount>& pins, EdgeHook hook = nullptr)
+        : EdgeInputSource(pins), _hook(hook)
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+            _contexts[i] = {this, static_cast<InputSignal>(i)};
+    }
+
+    // Begin
+    //
+    // Active-LOW inputs: idle = HIGH (held by internal pull-up), asserted = LOW.
+
+    void Begin()
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+        {
+            const uint8_t pin = _lines[i].pin;
+            if (pin == PIN_NONE)
+                continue;
+
+            pinMode(pin, INPUT_PULLUP);
+            attachInterruptArg(digitalPinToInterrupt(pin), OnInterrupt, &_contexts[i], CHANGE);
+        }
+    }
+};
+
+// ReplayInputSource
+//
+// The GPIO debounce with no IRQs behind it.  InputReplayer sets the virtual
+// pin levels and calls OnPinEdge() for each edge in the trace, so a replay
+// goes through exactly the logic the real pins do.
+
+class ReplayInputSource : public EdgeInputSource
+{
+public:
+    using EdgeInputSource::EdgeInputSource;
+};
+
+// ShiftRegisterInputSource
+//
+// Active-low inputs on a 74HC165 parallel-in shift register.  Each poll
+// latches all eight inputs at once and shifts them in, so every signal is
+// sampled at the same instant and no IRQs are needed.  A change counts once
+// the input has read the same for DebounceMs.
+
+class ShiftRegisterInputSource : public InputSource
+{
+public:
+    static constexpr uint8_t  NoBit      = 0xFF;
+    static constexpr uint32_t DebounceMs = EdgeInputSource::DebounceMs;
+
+private:
+    struct Line
+    {
+        uint8_t  bit      = NoBit; // Register input D0-D7 the signal is wired to
+        bool     asserted = false; // As last read
+        uint32_t sinceMs  = 0;     // When it last read differently
+        uint32_t changes  = 0;
+    };
+
+    const uint8_t                      _loadPin;
+    const uint8_t                      _clockPin;
+    const uint8_t                      _dataPin;
+    std::array<Line, InputSignalCount> _lines;
+    bool                               _resync = true;
+
+    // ReadAll
+    //
+    // Pulses the parallel load, then clocks the eight inputs out; D7 comes
+    // out first.  Returns bit n = level of input Dn.
+
+    uint8_t ReadAll() const
+    {
+        digitalWrite(_loadPin, LOW);
+        delayMicroseconds(1);
+        digitalWrite(_loadPin, HIGH);
+
+        uint8_t value = 0;
+        for (int bit = 7; bit >= 0; bit--)
+        {
+            if (digitalRead(_dataPin) == HIGH)
+                value |= 1 << bit;
+            digitalWrite(_clockPin, HIGH);
+            digitalWrite(_clockPin, LOW);
+        }
+        return value;
+    }
+
+public:
+    ShiftRegisterInputSource(uint8_t loadPin, uint8_t clockPin, uint8_t dataPin,
+                             const std::array<uint8_t, InputSignalCount>& bits)
+        : _loadPin(loadPin), _clockPin(clockPin), _dataPin(dataPin)
+    {
+        for (size_t i = 0; i < InputSignalCount; i++)
+            _lines[i].bit = bits[i];
+    }
+
+    void Begin()
+    {
+        pinMode(_loadPin, OUTPUT);
+        pinMode(_clockPin, OUTPUT);
+        pinMode(_dataPin, INPUT);
+        digitalWrite(_loadPin, HIGH);
+        digitalWrite(_clockPin, LOW);
+    }
+
+    uint8_t Provides() const override
+    {
+        uint8_t mask = 0;
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (_lines[i].bit != NoBit)
+                mask |= 1 << i;
+        return mask;
+    }
+
+    void Poll(InputUpdate& update) override
+    {
+        const uint32_t now = LightingMillis();
+        const uint8_t  raw = ReadAll();
+
+        for (size_t i = 0; i < InputSignalCount; i++)
+        {
+            Line& line = _lines[i];
+            if (line.bit == NoBit)
+                continue;
+
+            const bool asserted = !(raw & (1 << line.bit));
+            if (asserted != line.asserted)
+            {
+                line.asserted = asserted;
+                line.sinceMs  = now;
+                line.changes++;
+            }
+
+            const InputSignal signal = static_cast<InputSignal>(i);
+            if (_resync)
+                Report(update, signal, asserted, now, true);
+            else if (now - line.sinceMs > DebounceMs)
+                Report(update, signal, line.asserted, line.sinceMs);
+        }
+
+        _resync = false;
+    }
+
+    void Resync() override { _resync = true; }
+
+    uint32_t GetEventCount(InputSignal signal) const override
+    {
+        return _lines[static_cast<size_t>(signal)].changes;
+    }
+};
+
+// SimulatedInputSource
+//
+// Signals set by code rather than wiring, with no debounce.  Set() may be
+// called from any task; nothing is set until it's called, so an unused one
+// is an idle set of inputs.
+
+class SimulatedInputSource : public InputSource
+{
+    const uint8_t                          _provides;
+    uint8_t                                _state = 0;
+    std::array<uint32_t, InputSignalCount> _changeMs{};
+    std::array<uint32_t, InputSignalCount> _changes{};
+    bool                                   _resync = true;
+    portMUX_TYPE                           _mux    = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    explicit SimulatedInputSource(uint8_t provides = AllInputSignals) : _provides(provides) {}
+
+    void Set(InputSignal signal, bool asserted)
+    {
+        const size_t  i   = static_cast<size_t>(signal);
+        const uint8_t bit = SignalBit(signal);
+
+        portENTER_CRITICAL(&_mux);
+        if (asserted != bool(_state & bit))
+        {
+            _state ^= bit;
+            _changeMs[i] = LightingMillis();
+            _changes[i]++;
+        }
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    uint8_t Provides() const override { return _provides; }
+
+    void Poll(InputUpdate& update) override
+    {
+        portENTER_CRITICAL(&_mux);
+        const uint8_t                                state    = _state;
+        const std::array<uint32_t, InputSignalCount> changeMs = _changeMs;
+        portEXIT_CRITICAL(&_mux);
+
+        const uint32_t now = LightingMillis();
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (_provides & (1 << i))
+                Report(update, static_cast<InputSignal>(i), state & (1 << i),
+                       _resync ? now : changeMs[i], _resync);
+
+        _resync = false;
+    }
+
+    void Resync() override { _resync = true; }
+
+    uint32_t GetEventCount(InputSignal signal) const override
+    {
+        return _changes[static_cast<size_t>(signal)];
+    }
+};
+
+// LayeredInputSource
+//
+// Two sources polled as one.  Signals the upper source provides come only
+// from it; the lower one fills in the rest.
+
+class LayeredInputSource : public InputSource
+{
+    InputSource& _upper;
+    InputSource& _lower;
+
+public:
+    LayeredInputSource(InputSource& upper, InputSource& lower) : _upper(upper), _lower(lower) {}
+
+    uint8_t Provides() const override { return _upper.Provides() | _lower.Provides(); }
+
+    void Poll(InputUpdate& update) override
+    {
+        const uint8_t lowerOnly = _lower.Provides() & ~_upper.Provides();
+
+        InputUpdate lower = update;
+        lower.changed     = 0;
+        _lower.Poll(lower);
+
+        update.asserted = (update.asserted & ~lowerOnly) | (lower.asserted & lowerOnly);
+        update.changed |= lower.changed & lowerOnly;
+        for (size_t i = 0; i < InputSignalCount; i++)
+            if (lower.changed & lowerOnly & (1 << i))
+                update.changeMs[i] = lower.changeMs[i];
+
+        _upper.Poll(update);
+    }
+
+    void Resync() override
+    {
+        _upper.Resync();
+        _lower.Resync();
+    }
+
+    uint32_t GetEventCount(InputSignal signal) const override
+    {
+        return _upper.Provides() & SignalBit(signal) ? _upper.GetEventCount(signal)
+                                                     : _lower.GetEventCount(signal);
+    }
+};
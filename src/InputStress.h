@@ -0,0 +1,397 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        InputStress.h
+//
+// Description:
+//
+//   Input stress and soak testing.  StressSchedule generates a seeded
+//   random stream of the nastiest input sequences we know of: contact bounce
+//   on any pin, brakes (both turn circuits dropping within a few ms of each
+//   other), brake on top of the hazard flasher, the emergency switch toggled
+//   in the middle of a signal, and plain random toggles, with as many
+//   glitches on top as it takes to reach the edge rate.  The mix repeats
+//   for as long as the run is configured to last, at the configured average
+//   edge rate, and the same seed always gives the same schedule.
+//
+//   StressStats collects what came out the other end: the distribution of
+//   frame times, the IRQ rate and how many changes made it through the
+//   debounce, brake latency and frame deadline overruns.
+//
+//   Nothing here touches hardware or prints, so a schedule can be driven onto
+//   the real pins in real time, or fed through InputReplayer (see
+//   StressEdges) on the virtual clock, on the board or on a host.  The
+//   report is printed by main.cpp.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "FrameMonitor.h"
+#include "InputReplay.h"
+#include <array>
+
+// Pins a schedule drives, in this order
+
+enum class StressPin : uint8_t
+{
+    Left = 0,
+    Right,
+    Backup,
+    Emergency,
+    Count
+};
+
+inline constexpr size_t StressPinCount = static_cast<size_t>(StressPin::Count);
+
+struct StressConfig
+{
+    uint32_t seed           = 1;
+    uint32_t edgesPerSecond = 50;      // Average over the run, across all pins
+    uint32_t durationMs     = 3600000; // How long new sequences keep starting
+};
+
+// StressSchedule
+//
+// Each sequence is generated whole into a small queue, earliest edge first,
+// and edges are handed out from the front.  A new sequence is only started
+// once everything due before its start time has been handed out, and never
+// before the last edge handed out, so edge times never go backwards even
+// when sequences overlap.  Sequences on the same pins may interleave; that
+// is part of the point.
+//
+// Sequences are paced to make up to SequenceEdgesPerSecond on their own.
+// Any rate asked for beyond that is made up of glitches, single spikes on a
+// random pin, which is what heavy chatter on every input looks like.
+
+class StressSchedule
+{
+public:
+    static constexpr uint32_t MinEdgesPerSecond = 1;
+    static constexpr uint32_t MaxEdgesPerSecond = 2000;
+
+private:
+    static constexpr size_t   QueueSize              = 128;
+    static constexpr size_t   MaxSequenceEdges       = 56; // Most edges any one sequence pushes
+    static constexpr uint32_t AverageSequenceEdges   = 16; // Measured over the mix, for pacing
+    static constexpr uint32_t SequenceEdgesPerSecond = 20; // Any rate above this is glitches
+    static constexpr uint32_t ReleaseAfterUs         = 100000;
+
+    struct Edge
+    {
+        uint64_t timeUs : 48;
+        uint64_t pin    : 8; // StressPin
+        uint64_t level  : 8;
+    };
+
+    enum class Sequence : uint8_t
+    {
+        Toggle = 0,
+        Bounce,
+        Brake,
+        SignalThenEmergency,
+        HazardThenBrake,
+        Count
+    };
+
+    const std::array<uint8_t, StressPinCount> _pins;
+    const uint64_t                            _endUs;
+    const uint32_t                            _meanSequenceGapUs;
+    const uint32_t                            _meanGlitchGapUs; // 0 when there are none
+
+    uint32_t                            _random;
+    uint64_t                            _nextSequenceUs = 0;
+    uint64_t                            _nextGlitchUs   = 0;
+    uint64_t                            _lastUs         = 0;
+    bool                                _released       = false;
+    std::array<uint8_t, StressPinCount> _levels;
+    std::array<Edge, QueueSize>         _queue;
+    size_t                              _queued = 0;
+
+    // xorshift32: tiny, fast and plenty random for picking edge times
+
+    uint32_t Random()
+    {
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        return _random;
+    }
+
+    uint32_t Random(uint32_t low, uint32_t high) { return low + Random() % (high - low); }
+
+    bool CanStartAt(uint64_t timeUs, size_t edges) const
+    {
+        return timeUs < _endUs && QueueSize - _queued >= edges &&
+               (_queued == 0 || _queue[0].timeUs > timeUs);
+    }
+
+    void Push(uint64_t timeUs, StressPin pin, uint8_t level)
+    {
+        if (_queued == QueueSize)
+            return;
+
+        size_t i = _queued++;
+        for (; i > 0 && _queue[i - 1].timeUs > timeUs; i--)
+            _queue[i] = _queue[i - 1];
+        _queue[i] = {timeUs, static_cast<uint64_t>(pin), level};
+    }
+
+    // Bounce
+    //
+    // Takes pin to level the way a relay contact or bulb-sense circuit does,
+    // chattering a few times first.  Returns when it settles.
+
+    uint64_t Bounce(uint64_t timeUs, StressPin pin, uint8_t level)
+    {
+        for (uint32_t i = Random(0, 5); i > 0; i--)
+        {
+            Push(timeUs, pin, level);
+            timeUs += Random(50, 3000);
+            Push(timeUs, pin, !level);
+            timeUs += Random(50, 3000);
+        }
+        Push(timeUs, pin, level);
+        return timeUs;
+    }
+
+    // Both turn circuits dropping (or coming back) a few ms apart
+
+    uint64_t BothTurns(uint64_t timeUs, uint8_t level)
+    {
+        const bool     leftFirst = Random() & 1;
+        const uint64_t first     = Bounce(timeUs, leftFirst ? StressPin::Left : StressPin::Right, level);
+        return max(first, Bounce(timeUs + Random(0, 10000), leftFirst ? StressPin::Right : StressPin::Left,
+                                 level));
+    }
+
+    void Generate(uint64_t timeUs)
+    {
+        switch (static_cast<Sequence>(Random(0, static_cast<uint32_t>(Sequence::Count))))
+        {
+            case Sequence::Toggle:
+            {
+                const StressPin pin = static_cast<StressPin>(Random(0, StressPinCount));
+                Push(timeUs, pin, !_levels[static_cast<size_t>(pin)]);
+                break;
+            }
+
+            case Sequence::Bounce:
+            {
+                const StressPin pin = static_cast<StressPin>(Random(0, StressPinCount));
+                Bounce(timeUs, pin, !_levels[static_cast<size_t>(pin)]);
+                break;
+            }
+
+            case Sequence::Brake:
+            {
+                const uint64_t pressed = BothTurns(timeUs, LOW);
+                BothTurns(pressed + Random(100000, 1500000), HIGH);
+                break;
+            }
+
+            case Sequence::SignalThenEmergency:
+            {
+                const StressPin signal = Random() & 1 ? StressPin::Left : StressPin::Right;
+                const uint64_t  on     = Bounce(timeUs, signal, LOW);
+                const uint64_t  tap    = Bounce(on + Random(200000, 900000), StressPin::Emergency, LOW);
+                Bounce(tap + Random(30000, 80000), StressPin::Emergency, HIGH);
+                Bounce(on + Random(500000, 2000000), signal, HIGH);
+                break;
+            }
+
+            case Sequence::HazardThenBrake:
+            {
+                // The flasher switches both sides together, about 1.5 Hz
+
+                const uint32_t cycles = Random(2, 6);
+                uint64_t       t      = timeUs;
+                for (uint32_t i = 0; i < cycles; i++)
+                {
+                    Push(t, StressPin::Left, LOW);
+                    Push(t + Random(0, 2000), StressPin::Right, LOW);
+                    t += 330000;
+                    Push(t, StressPin::Left, HIGH);
+                    Push(t + Random(0, 2000), StressPin::Right, HIGH);
+                    t += 330000;
+                }
+
+                // Brake pressed at some point during the flashing, held past it
+
+                const uint64_t pressed = BothTurns(timeUs + Random(0, cycles * 660000), LOW);
+                BothTurns(max(pressed, t) + Random(100000, 1000000), HIGH);
+                break;
+            }
+
+            default: break;
+        }
+    }
+
+    static uint32_t Rate(const StressConfig& config)
+    {
+        return constrain(config.edgesPerSecond, MinEdgesPerSecond, MaxEdgesPerSecond);
+    }
+
+public:
+    StressSchedule(const StressConfig& config, const std::array<uint8_t, StressPinCount>& pins)
+        : _pins(pins),
+          _endUs(static_cast<uint64_t>(config.durationMs) * 1000),
+          _meanSequenceGapUs(1000000 * AverageSequenceEdges / min(Rate(config), SequenceEdgesPerSecond)),
+          _meanGlitchGapUs(Rate(config) > SequenceEdgesPerSecond
+                               ? 2000000 / (Rate(config) - SequenceEdgesPerSecond)
+                               : 0),
+          _random(config.seed ? config.seed : 1)
+    {
+        _levels.fill(HIGH);
+    }
+
+    // Next
+    //
+    // Fills in the next edge, with the low 32 bits of its time in us since
+    // the start of the schedule, as InputEdge carries.  Returns false once
+    // the schedule is over; by then every pin has been returned to idle.
+
+    bool Next(InputEdge& edge)
+    {
+        for (;;)
+        {
+            if (CanStartAt(_nextSequenceUs, MaxSequenceEdges))
+            {
+                Generate(max(_nextSequenceUs, _lastUs));
+                _nextSequenceUs += Random(0, 2 * _meanSequenceGapUs);
+            }
+            else if (_meanGlitchGapUs && CanStartAt(_nextGlitchUs, 2))
+            {
+                // A single spike on one pin, there and gone again within 3 ms
+
+                const StressPin pin   = static_cast<StressPin>(Random(0, StressPinCount));
+                const uint8_t   level = _levels[static_cast<size_t>(pin)];
+                const uint64_t  start = max(_nextGlitchUs, _lastUs);
+
+                Push(start, pin, !level);
+                Push(start + Random(50, 3000), pin, level);
+                _nextGlitchUs += Random(0, 2 * _meanGlitchGapUs);
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (_queued == 0 && !_released)
+        {
+            _released = true;
+            for (size_t i = 0; i < StressPinCount; i++)
+                if (_levels[i] == LOW)
+                    Push(_lastUs + ReleaseAfterUs, static_cast<StressPin>(i), HIGH);
+        }
+
+        if (_queued == 0)
+            return false;
+
+        const Edge& next = _queue[0];
+        _lastUs           = next.timeUs;
+        _levels[next.pin] = next.level;
+        edge.timeUs       = static_cast<uint32_t>(next.timeUs);
+        edge.pin          = _pins[next.pin];
+        edge.level        = next.level;
+
+        std::copy(_queue.begin() + 1, _queue.begin() + _queued, _queue.begin());
+        _queued--;
+        return true;
+    }
+
+    // Time of the edge Next() last returned, in full
+    uint64_t GetLastTimeUs() const { return _lastUs; }
+};
+
+// StressEdges
+//
+// A StressSchedule as the indexed edge source that InputReplayer walks.  The
+// replayer only ever reads the edge it's on or the next one, so only the
+// current edge is kept, and the length is found by running an identical
+// schedule through once up front.
+
+class StressEdges
+{
+    mutable StressSchedule _schedule;
+    mutable InputEdge      _edge{};
+    mutable size_t         _index = SIZE_MAX;
+    size_t                 _count = 0;
+
+public:
+    StressEdges(const StressConfig& config, const std::array<uint8_t, StressPinCount>& pins)
+        : _schedule(config, pins)
+    {
+        StressSchedule counter(config, pins);
+        InputEdge      edge;
+        while (counter.Next(edge))
+            _count++;
+    }
+
+    size_t size() const { return _count; }
+
+    const InputEdge& operator[](size_t i) const
+    {
+        while (_index != i)
+        {
+            _schedule.Next(_edge);
+            _index++;
+        }
+        return _edge;
+    }
+};
+
+// StressStats
+//
+// Filled in by whoever runs the schedule, then printed.
+
+struct StressStats
+{
+    // Upper bounds of the frame time buckets; the last bucket is everything
+    // slower than the last bound
+
+    static constexpr std::array<uint32_t, 8> FrameBucketUs = {2000,  4000,  8000,  12000,
+                                                              16000, 20000, 33000, 50000};
+
+    uint32_t                                       frames       = 0;
+    std::array<uint32_t, FrameBucketUs.size() + 1> frameBuckets{};
+    uint64_t                                       frameUsTotal = 0;
+    uint32_t                                       frameUsMax   = 0;
+
+    uint32_t edges        = 0; // Edges driven
+    uint32_t irqs         = 0; // Edges the input source's IRQs saw
+    uint32_t inputChanges = 0; // Changes that made it through the debounce
+    uint32_t elapsedMs   = 0;
+
+    uint32_t brakes              = 0;
+    uint64_t brakeLatencyTotalMs = 0;
+    uint32_t brakeLatencyMaxMs   = 0;
+
+    std::array<uint32_t, OverrunCauseCount> overruns{};
+
+    // changed is the frame's InputUpdate::changed
+
+    void RecordFrame(uint32_t frameUs, uint8_t changed)
+    {
+        inputChanges += __builtin_popcount(changed);
+
+        size_t bucket = 0;
+        while (bucket < FrameBucketUs.size() && frameUs >= FrameBucketUs[bucket])
+            bucket++;
+
+        frames++;
+        frameBuckets[bucket]++;
+        frameUsTotal += frameUs;
+        frameUsMax    = max(frameUsMax, frameUs);
+    }
+
+    void RecordBrake(uint32_t latencyMs)
+    {
+        brakes++;
+        brakeLatencyTotalMs += latencyMs;
+        brakeLatencyMaxMs    = max(brakeLatencyMaxMs, latencyMs);
+    }
+};
@@ -9,6 +9,13 @@
 //   Provides a Adafruit_GFX implementation for our RGB LED panel so that
 //   we can use primitives such as lines and fills on it.
 //
+//   Drawing is kept at full 8-bit precision in the strip's own buffer.
+//   Brightness and color correction are left to FastLED, which applies them
+//   in the same pass that sends the pixels and dithers the bits they scale
+//   away over successive frames, so dim effects keep their low levels.  There
+//   is no gamma stage: the effects' colors are tuned as raw values, so
+//   FastLED sends the drawing buffer as is.
+//
 // History:     Oct-9-2018    Davepl      Created from other projects
 //              May-27-2026   Davepl      Adapted for Lincoln, Cleanup
 //
@@ -20,13 +27,29 @@
 #include "FastLED.h"
 #include "globals.h"
 #include "pixeltypes.h"
+#include <algorithm>
 #include <array>
+#include <math.h>
 
 class LEDStripGFX : public Adafruit_GFX
 {
 private:
     std::array<CRGB, NUMBER_USED_PIXELS> _leds{};
     size_t                               _width;
+    CRGB                                 _correction = CRGB(UncorrectedColor);
+
+    // Running sum of each color channel over the whole strip, kept up to date
+    // on every write so the power limiter never has to rescan the buffer.
+    std::array<uint32_t, 3> _channelTotals{};
+
+    void SetLED(size_t i, CRGB color)
+    {
+        const CRGB old = _leds[i];
+        _channelTotals[0] += color.r - old.r;
+        _channelTotals[1] += color.g - old.g;
+        _channelTotals[2] += color.b - old.b;
+        _leds[i]           = color;
+    }
 
     bool Contains(int16_t x, int16_t y) const
     {
@@ -46,27 +69,58 @@ public:
     {
         FastLED.addLeds<WS2812B, LED_PIN, GRB>(_leds.data(), _width);
         FastLED.setBrightness(255);
+        FastLED.setCorrection(_correction);
+        FastLED.setDither(BINARY_DITHER);
     }
 
     void ShowStrip() { FastLED.show(); }
 
     void setBrightness(byte brightness) { FastLED.setBrightness(brightness); }
 
-    CRGB* GetLEDBuffer() { return _leds.data(); }
+    // Per-channel color correction, which FastLED applies along with the
+    // brightness.
+
+    void SetColorCorrection(CRGB correction)
+    {
+        _correction = correction;
+        FastLED.setCorrection(_correction);
+    }
+
+    // Read-only: all writes have to go through the draw calls so that the
+    // channel totals stay correct.
+    const CRGB* GetLEDBuffer() const { return _leds.data(); }
+
+    // Sum of the R, G and B values of every pixel, as written (before the
+    // output stage).  Correction only ever reduces a channel, so
+    // estimates made from these and the brightness are on the safe side.
+    const std::array<uint32_t, 3>& GetChannelTotals() const { return _channelTotals; }
 
     size_t GetLEDCount() const { return _width; }
 
-    static const byte gamma5[];
-    static const byte gamma6[];
+    // Hash
+    //
+    // 32-bit FNV-1a hash of the pixels, for checking that a change to the
+    // render path didn't change what ends up on the strip.
 
-    inline static CRGB from16Bit(
-        uint16_t color) // Convert 16bit 5:6:5 to 24bit color using lookup table for gamma
+    uint32_t Hash() const
     {
-        byte r = gamma5[color >> 11];
-        byte g = gamma6[(color >> 5) & 0x3F];
-        byte b = gamma5[color & 0x1F];
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < _width; i++)
+            for (uint8_t channel : {_leds[i].r, _leds[i].g, _leds[i].b})
+                hash = (hash ^ channel) * 16777619u;
+        return hash;
+    }
+
+    // Convert 16bit 5:6:5 to 24bit color.  The top bits are repeated into the
+    // bottom ones so that full scale stays full scale.
 
-        return CRGB(r, g, b);
+    inline static CRGB from16Bit(uint16_t color)
+    {
+        const byte r = color >> 11;
+        const byte g = (color >> 5) & 0x3F;
+        const byte b = color & 0x1F;
+
+        return CRGB((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
     }
 
     static inline uint16_t to16bit(uint8_t r, uint8_t g, uint8_t b) // Convert RGB -> 16bit 5:6:5
@@ -109,18 +163,45 @@ public:
     void drawPixel(int16_t x, int16_t y, uint16_t color) override
     {
         if (Contains(x, y))
-            _leds[getPixelIndex(x, y)] = from16Bit(color);
+            SetLED(getPixelIndex(x, y), from16Bit(color));
     }
 
     void drawPixel(int16_t x, int16_t y, CRGB color)
     {
         if (Contains(x, y))
-            _leds[getPixelIndex(x, y)] = color;
+            SetLED(getPixelIndex(x, y), color);
     }
 
     void drawPixel(size_t x, CRGB color)
     {
         if (x < _width)
-            _leds[x] = color;
+            SetLED(x, color);
+    }
+
+    // FillSpan
+    //
+    // Sets count pixels starting at first to color, clipped to the strip.
+    // Much cheaper than a drawPixel per pixel, and the effects' usual way of
+    // drawing runs of a single color.
+
+    void FillSpan(size_t first, size_t count, CRGB color)
+    {
+        if (first >= _width)
+            return;
+        count = min(count, _width - first);
+
+        for (size_t i = first; i < first + count; i++)
+            SetLED(i, color);
+    }
+
+    // Clearing the whole strip is common enough (every frame) to skip the
+    // Adafruit_GFX rectangle path and reset the totals outright.
+
+    void fillScreen(uint16_t color) override
+    {
+        const CRGB rgb = from16Bit(color);
+        std::fill_n(_leds.begin(), _width, rgb);
+        _channelTotals = {static_cast<uint32_t>(rgb.r * _width), static_cast<uint32_t>(rgb.g * _width),
+                          static_cast<uint32_t>(rgb.b * _width)};
     }
 };
@@ -0,0 +1,417 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        LifetimeStats.h
+//
+// Description:
+//
+//   Statistics kept for the life of the light rather than since boot: boots,
+//   brake activations, worst brake latency, on-time per effect, frame
+//   overruns, frame stalls, wakes from light sleep and input events.  The
+//   render loop updates them in RAM; they only go to flash when Flush() is
+//   called, which main.cpp does just before light sleep (and, if built with
+//   LIFETIME_IDLE_FLUSH, while the strip is idle), never mid-frame (a flash
+//   write stalls both cores).
+//
+//   Flushes are batched and rate limited, and the whole record is one small
+//   blob under one key.  NVS writes every update to a fresh entry and moves on
+//   through its pages, so the wear spreads over the whole partition on its
+//   own; what we control is how often we write.  SimulatedNvsStorage models
+//   that page rotation so the erase count for a given flush pattern can be
+//   worked out on the bench or on a host (see SimulateLifetimeWear).
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "FrameMonitor.h"
+#include <Preferences.h>
+#include <array>
+#include <atomic>
+#include <string.h>
+
+// LifetimeCounters
+//
+// The record as stored.  Bump Version whenever the layout changes; a stored
+// record of another version or size is ignored and counting starts over.
+
+struct LifetimeCounters
+{
+    static constexpr uint32_t Version    = 3;
+    static constexpr size_t   MaxEffects = 8;
+
+    uint32_t                                version           = Version;
+    uint32_t                                boots             = 0;
+    uint32_t                                brakes            = 0;
+    uint32_t                                maxBrakeLatencyMs = 0;
+    std::array<uint32_t, MaxEffects>        effectOnSeconds{};
+    std::array<uint32_t, OverrunCauseCount> overruns{};
+    uint32_t                                wakes       = 0;
+    uint32_t                                flushes     = 0; // Times this record has been written
+    uint32_t                                stalls      = 0; // Frames that ran past the stall limit
+    uint32_t                                stallResets = 0; // Of those, ones the watchdog reset
+    uint64_t                                inputEvents = 0; // Input IRQs (or CAN changes)
+};
+
+// No padding, so that memcmp sees only the counters
+static_assert(sizeof(LifetimeCounters) == 88, "LifetimeCounters has padding");
+
+// StatsStorage
+//
+// Somewhere to keep one LifetimeCounters blob.
+
+class StatsStorage
+{
+public:
+    virtual ~StatsStorage() = default;
+
+    // Fills in data and returns true if exactly size bytes were stored
+    virtual bool Load(void* data, size_t size) = 0;
+
+    virtual bool Save(const void* data, size_t size) = 0;
+};
+
+// NvsStatsStorage
+//
+// The blob in the NVS partition, through the Arduino Preferences wrapper.
+
+class NvsStatsStorage : public StatsStorage
+{
+    static constexpr const char* Namespace = "lifetime";
+    static constexpr const char* Key       = "counters";
+
+    Preferences _preferences;
+    bool        _open = false;
+
+    bool Open()
+    {
+        if (!_open)
+            _open = _preferences.begin(Namespace, false);
+        return _open;
+    }
+
+public:
+    bool Load(void* data, size_t size) override
+    {
+        return Open() && _preferences.getBytesLength(Key) == size &&
+               _preferences.getBytes(Key, data, size) == size;
+    }
+
+    bool Save(const void* data, size_t size) override
+    {
+        return Open() && _preferences.putBytes(Key, data, size) == size;
+    }
+};
+
+// SimulatedNvsStorage
+//
+// A RAM stand-in for NVS that also counts wear.  NVS never rewrites an entry
+// in place: each save appends the blob to the current page (a 32-byte header
+// entry, the data rounded up to 32-byte entries, and an index entry), and
+// when the pages run out the oldest one is erased to make room.  Flash
+// endurance is counted in erases per page.
+
+class SimulatedNvsStorage : public StatsStorage
+{
+public:
+    static constexpr size_t   PageCount      = 5;   // Default 20K NVS partition
+    static constexpr size_t   EntriesPerPage = 126; // 4K page less its header and bitmap
+    static constexpr size_t   EntryBytes     = 32;
+    static constexpr uint32_t EraseEndurance = 100000;
+
+private:
+    std::array<uint8_t, sizeof(LifetimeCounters)> _data{};
+    size_t                                        _size = 0;
+
+    size_t                          _page      = 0;
+    size_t                          _pageUsed  = 0; // Entries used in _page
+    size_t                          _pagesUsed = 1; // Pages in use, until they've all been used
+    uint32_t                        _saves     = 0;
+    std::array<uint32_t, PageCount> _erases{};
+
+public:
+    bool Load(void* data, size_t size) override
+    {
+        if (size != _size)
+            return false;
+        memcpy(data, _data.data(), size);
+        return true;
+    }
+
+    bool Save(const void* data, size_t size) override
+    {
+        if (size > _data.size())
+            return false;
+
+        const size_t entries = 2 + (size + EntryBytes - 1) / EntryBytes;
+        if (_pageUsed + entries > EntriesPerPage)
+        {
+            // NVS keeps one page free; moving onto a page that's been written
+            // before means erasing it first
+            _page     = (_page + 1) % PageCount;
+            _pageUsed = 0;
+            if (_pagesUsed < PageCount - 1)
+                _pagesUsed++;
+            else
+                _erases[_page]++;
+        }
+        _pageUsed += entries;
+
+        memcpy(_data.data(), data, size);
+        _size = size;
+        _saves++;
+        return true;
+    }
+
+    uint32_t GetSaves() const { return _saves; }
+
+    uint32_t GetMaxPageErases() const
+    {
+        uint32_t worst = 0;
+        for (uint32_t erases : _erases)
+            worst = max(worst, erases);
+        return worst;
+    }
+};
+
+// LifetimeStats
+//
+// Counters for the N effects in g_AllEffects order.  The Record calls come
+// from the render loop and take only a short critical section; the totals
+// can be read from any task.
+
+template <size_t N> class LifetimeStats
+{
+    static_assert(N <= LifetimeCounters::MaxEffects, "Too many effects for the stored record");
+
+public:
+    // Shortest time between flushes while idle, and before light sleep.  A
+    // car that sleeps and wakes every minute all its life costs a save a
+    // minute.  A save is 5 of a page's 126 entries, so with 5 pages in
+    // rotation each page is erased about once every 125 saves: about 4,200
+    // erases a year against an endurance of 100,000.
+
+    static constexpr uint32_t IdleFlushIntervalMs  = 10 * 60 * 1000;
+    static constexpr uint32_t SleepFlushIntervalMs = 60 * 1000;
+
+private:
+    StatsStorage&    _storage;
+    LifetimeCounters _stored; // As loaded at boot
+    LifetimeCounters _saved;  // As last written, to tell whether anything changed
+
+    // Since boot
+
+    uint32_t                                _brakes            = 0;
+    uint32_t                                _maxBrakeLatencyMs = 0;
+    std::array<uint64_t, N>                 _effectOnMs{};
+    std::array<uint32_t, OverrunCauseCount> _overruns{};
+    uint32_t                                _wakes       = 0;
+    uint32_t                                _stalls      = 0;
+    uint32_t                                _stallResets = 0;
+    uint64_t                                _inputEvents = 0;
+
+    uint32_t          _lastFlushMs = 0;
+    bool              _flushedOnce = false;
+    std::atomic<bool> _begun{false};
+    portMUX_TYPE      _mux = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    explicit LifetimeStats(StatsStorage& storage) : _storage(storage) {}
+
+    // Begin
+    //
+    // Loads whatever was stored and counts this boot.  Returns false if
+    // nothing usable was stored, in which case counting starts from zero.
+
+    bool Begin()
+    {
+        LifetimeCounters stored;
+        const bool       loaded =
+            _storage.Load(&stored, sizeof(stored)) && stored.version == LifetimeCounters::Version;
+
+        _stored = loaded ? stored : LifetimeCounters();
+        _saved  = _stored;
+        _stored.boots++;
+        _begun = true;
+        return loaded;
+    }
+
+    // Render loop side
+
+    void RecordFrame(uint8_t activeMask, uint32_t elapsedMs)
+    {
+        portENTER_CRITICAL(&_mux);
+        for (size_t i = 0; i < N; i++)
+            if (activeMask & (1 << i))
+                _effectOnMs[i] += elapsedMs;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    void RecordBrake(uint32_t latencyMs)
+    {
+        portENTER_CRITICAL(&_mux);
+        _brakes++;
+        _maxBrakeLatencyMs = max(_maxBrakeLatencyMs, latencyMs);
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    void RecordOverrun(OverrunCause cause)
+    {
+        portENTER_CRITICAL(&_mux);
+        _overruns[static_cast<size_t>(cause)]++;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    void RecordWake()
+    {
+        portENTER_CRITICAL(&_mux);
+        _wakes++;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    // Stalls are counted at the next boot, from the record that survives the
+    // watchdog reset, since the reset loses anything counted in RAM
+
+    void RecordStalls(uint32_t stalls, bool watchdogReset)
+    {
+        portENTER_CRITICAL(&_mux);
+        _stalls += stalls;
+        _stallResets += stalls && watchdogReset;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    // Input sources count their own events since boot; pass that count in
+    void SetInputEvents(uint64_t sinceBoot)
+    {
+        portENTER_CRITICAL(&_mux);
+        _inputEvents = sinceBoot;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    // GetTotals
+    //
+    // What was stored at boot plus everything since.
+
+    LifetimeCounters GetTotals()
+    {
+        LifetimeCounters totals = _stored;
+
+        portENTER_CRITICAL(&_mux);
+        totals.brakes            += _brakes;
+        totals.maxBrakeLatencyMs  = max(totals.maxBrakeLatencyMs, _maxBrakeLatencyMs);
+        for (size_t i = 0; i < N; i++)
+            totals.effectOnSeconds[i] += _effectOnMs[i] / 1000;
+        for (size_t i = 0; i < OverrunCauseCount; i++)
+            totals.overruns[i] += _overruns[i];
+        totals.wakes       += _wakes;
+        totals.stalls      += _stalls;
+        totals.stallResets += _stallResets;
+        totals.inputEvents += _inputEvents;
+        totals.flushes = _saved.flushes;
+        portEXIT_CRITICAL(&_mux);
+
+        return totals;
+    }
+
+    // Flush
+    //
+    // Writes the totals if anything changed and the last write was at least
+    // minIntervalMs ago.  Returns true if it wrote.  Only call this when a
+    // flash write can't hold up a frame, and never before Begin().
+
+    bool Flush(uint32_t nowMs, uint32_t minIntervalMs)
+    {
+        if (!_begun || (_flushedOnce && nowMs - _lastFlushMs < minIntervalMs))
+            return false;
+
+        LifetimeCounters totals = GetTotals();
+        if (memcmp(&totals, &_saved, sizeof(totals)) == 0)
+            return false;
+
+        totals.flushes++;
+        if (!_storage.Save(&totals, sizeof(totals)))
+            return false;
+
+        portENTER_CRITICAL(&_mux);
+        _saved = totals;
+        portEXIT_CRITICAL(&_mux);
+
+        _lastFlushMs = nowMs;
+        _flushedOnce = true;
+        return true;
+    }
+
+    void Print(const std::array<const char*, N>& effectNames)
+    {
+        const LifetimeCounters totals = GetTotals();
+
+        Serial.printf("Lifetime: %lu boots, %lu wakes, %llu input events, saved %lu times\n",
+                      (unsigned long)totals.boots, (unsigned long)totals.wakes,
+                      (unsigned long long)totals.inputEvents, (unsigned long)totals.flushes);
+        Serial.printf("  Brakes %lu, worst latency %lu ms\n", (unsigned long)totals.brakes,
+                      (unsigned long)totals.maxBrakeLatencyMs);
+
+        Serial.printf("  On time:");
+        for (size_t i = 0; i < N; i++)
+            Serial.printf(" %s %lu:%02lu:%02lu", effectNames[i],
+                          (unsigned long)(totals.effectOnSeconds[i] / 3600),
+                          (unsigned long)(totals.effectOnSeconds[i] / 60 % 60),
+                          (unsigned long)(totals.effectOnSeconds[i] % 60));
+        Serial.println();
+
+        Serial.printf("  Overruns:");
+        for (size_t i = 0; i < OverrunCauseCount; i++)
+            Serial.printf(" %s %lu", FrameMonitor::CauseName(static_cast<OverrunCause>(i)),
+                          (unsigned long)totals.overruns[i]);
+        Serial.println();
+
+        Serial.printf("  Stalls %lu, %lu of them ended by the watchdog\n", (unsigned long)totals.stalls,
+                      (unsigned long)totals.stallResets);
+    }
+};
+
+// SimulateLifetimeWear
+//
+// Runs the flush policy over days of simulated use against
+// SimulatedNvsStorage and reports the flash wear: each day has sleepsPerDay
+// wake and sleep cycles, each with a few brakes, and with idleFlush every
+// fourth idles long enough for an idle flush.  Prints the saves, the worst
+// erase count of any page and how long the flash would last at that rate,
+// and returns the worst erase count.
+
+inline uint32_t SimulateLifetimeWear(uint32_t days, uint32_t sleepsPerDay, bool idleFlush)
+{
+    SimulatedNvsStorage storage;
+    LifetimeStats<1>    stats(storage);
+    stats.Begin();
+
+    const uint32_t cycleMs = 24 * 60 * 60 * 1000 / sleepsPerDay;
+    uint32_t       nowMs   = 0;
+
+    for (uint32_t day = 0; day < days; day++)
+    {
+        for (uint32_t cycle = 0; cycle < sleepsPerDay; cycle++)
+        {
+            stats.RecordWake();
+            stats.RecordBrake(40);
+            stats.RecordFrame(1, 3000);
+
+            if (idleFlush && cycle % 4 == 0)
+                stats.Flush(nowMs + cycleMs / 2, LifetimeStats<1>::IdleFlushIntervalMs);
+
+            nowMs += cycleMs;
+            stats.Flush(nowMs, LifetimeStats<1>::SleepFlushIntervalMs);
+        }
+    }
+
+    const uint32_t erases = storage.GetMaxPageErases();
+    Serial.printf("NVS wear, %lu days at %lu sleeps a day: %lu saves, worst page erased %lu times, "
+                  "endurance reached in %lu years\n",
+                  (unsigned long)days, (unsigned long)sleepsPerDay, (unsigned long)storage.GetSaves(),
+                  (unsigned long)erases,
+                  (unsigned long)(erases ? SimulatedNvsStorage::EraseEndurance / 365 * days / erases
+                                         : 0));
+    return erases;
+}
@@ -16,7 +16,8 @@
 //        the signal would need to come on immediately rather than emulate
 //        the incandescent fadein as it does now.  There are many FMVSS and
 //        other federal, state and local ordinances you would need to worry
-//        about before using this on a vehicle on the street.
+//        about before using this on a vehicle on the street.  (The
+//        Sequential signal mode does come on all at once.)
 //
 //---------------------------------------------------------------------------
 
@@ -39,7 +40,7 @@ inline constexpr uint32_t AMBER5  = 0x100300;
 // to come on "all in" and then animate from there, based on what I see Audi and
 // others doing, anyway.
 
-inline const TProgmemRGBPalette16 SignalColors_p FL_PROGMEM = 
+inline constexpr TProgmemRGBPalette16 SignalColors_p =
 {
     CRGB::Black, CRGB::Black, CRGB::Black, CRGB::Black, AMBERHI,
     AMBER1,      AMBER1,      AMBER2,      AMBER3,      AMBER4,
@@ -47,7 +48,44 @@ inline const TProgmemRGBPalette16 SignalColors_p FL_PROGMEM =
 
 };
 
-inline CRGBPalette256 SignalColors_pal = SignalColors_p;
+// ExpandPalette16
+//
+// Builds the 256-entry form of a 16-entry palette at compile time, blending
+// between neighbouring entries (and from the last entry back around to the
+// first) with the same scale8 math that FastLED's CRGBPalette256 uses when it
+// upscales one at run time.  The result is a table of 0xRRGGBB values that
+// stays in flash instead of being expanded into RAM during static init.
+
+constexpr uint8_t PaletteScale8(uint8_t value, uint8_t scale)
+{
+    return (static_cast<uint16_t>(value) * (static_cast<uint16_t>(scale) + 1)) >> 8;
+}
+
+constexpr std::array<uint32_t, 256> ExpandPalette16(const TProgmemRGBPalette16& palette)
+{
+    std::array<uint32_t, 256> expanded{};
+
+    for (size_t index = 0; index < expanded.size(); index++)
+    {
+        const uint32_t lower = palette[index >> 4];
+        const uint32_t upper = palette[((index >> 4) + 1) & 0x0F];
+        const uint8_t  f2    = (index & 0x0F) << 4;
+        const uint8_t  f1    = 255 - f2;
+
+        uint32_t color = 0;
+        for (int shift = 16; shift >= 0; shift -= 8)
+        {
+            uint8_t channel = lower >> shift;
+            if (f2)
+                channel = PaletteScale8(channel, f1) + PaletteScale8(upper >> shift, f2);
+            color |= static_cast<uint32_t>(channel) << shift;
+        }
+        expanded[index] = color;
+    }
+    return expanded;
+}
+
+inline constexpr std::array<uint32_t, 256> SignalColors_pal = ExpandPalette16(SignalColors_p);
 
 // LightingEvent (eg: BrakingEvent, SignalEvent, etc)
 //
@@ -59,124 +97,43 @@ inline CRGBPalette256 SignalColors_pal = SignalColors_p;
 // In short, you create a derived class and then call Begin() when the
 // event starts (like braking), and Update keeps track of the current
 // state.  Draw() actually renders the current state of the effect to
-// the light strip.
+// the light strip.  Effects know nothing about where their inputs come
+// from; the render loop hands them input changes through Apply().
 
 class LightingEvent
 {
 protected:
     unsigned long _eventStart = 0;     // Timestamp for when the current state was entered
     bool          _active     = false; // Should we be drawing?
-    portMUX_TYPE  _mux = portMUX_INITIALIZER_UNLOCKED; // A mutex since we also touch vars under
-                                                       // interrupt
-
-    bool              _hasIRQHandlerFiredYet = false;
-    int               _lastIRQButtonState    = HIGH;
-    uint32_t          _lastIRQTimeMs         = 0;
-    volatile uint32_t _irqCount              = 0; // total IRQs seen on this pin (diagnostic)
-
-    uint8_t _buttonPin1 = PIN_NONE;
-    uint8_t _buttonPin2 = PIN_NONE;
-
-    static constexpr uint32_t DebounceMs = 30;
 
     LEDStripGFX* _pStrip = nullptr;
 
-    bool SecondaryInputAllowsStart() const
-    {
-        return _buttonPin2 == PIN_NONE || IsInputPressed(_buttonPin2);
-    }
-
-    void AcknowledgePendingIRQ()
-    {
-        portENTER_CRITICAL(&_mux);
-        _hasIRQHandlerFiredYet = false;
-        portEXIT_CRITICAL(&_mux);
-    }
-
 public:
-    LightingEvent(LEDStripGFX* pStrip, uint8_t buttonPin1, uint8_t buttonPin2 = PIN_NONE)
+    LightingEvent(LEDStripGFX* pStrip)
     {
         _pStrip     = pStrip;
         _eventStart = 0;
         _active     = false;
-        _buttonPin1 = buttonPin1;
-        _buttonPin2 = buttonPin2;
-    }
-
-    void IRQ()
-    {
-        portENTER_CRITICAL_ISR(&_mux);
-        int newState           = digitalRead(_buttonPin1);
-        _lastIRQButtonState    = newState; // Save last button state
-        _lastIRQTimeMs         = xTaskGetTickCountFromISR() * portTICK_PERIOD_MS;
-        _hasIRQHandlerFiredYet = true; // Increment count of IRQs in the current state
-        _irqCount++;
-        portEXIT_CRITICAL_ISR(&_mux);
-    }
-
-    uint8_t  GetPin() const { return _buttonPin1; }
-    uint32_t GetIRQCount() const { return _irqCount; }
-
-    void SyncToInput()
-    {
-        if (_buttonPin1 == PIN_NONE)
-            return;
-
-        if (IsInputPressed(_buttonPin1) && SecondaryInputAllowsStart())
-            Begin();
-
-        AcknowledgePendingIRQ();
     }
 
-    // CheckForButtonPress
+    // Apply
     //
-    // Checks to see if the input is done bouncing. Active-low inputs begin the
-    // effect when asserted and end it when released.
+    // The input driving this effect changed: asserted begins the effect,
+    // released ends it.
 
-    void CheckForButtonPress()
+    void Apply(bool asserted)
     {
-        if (_buttonPin1 == PIN_NONE)
-            return;
-
-        int currentState = digitalRead(_buttonPin1);
-
-        portENTER_CRITICAL(&_mux);
-        bool     save             = _hasIRQHandlerFiredYet;
-        uint32_t saveLastIRQTime  = _lastIRQTimeMs;
-        int      saveLastIRQState = _lastIRQButtonState;
-        portEXIT_CRITICAL(&_mux);
-
-        // Don't enable this except for temporary debugging, it'd be far too often
-        // and verbose otherwise
-        //
-        // Serial.printf("Buttons: 36-%u 37-%u 38-%u 39-%u\n", digitalRead(36),
-        // digitalRead(37), digitalRead(38), digitalRead(39));
-
-        // If we have interrupts indicating state changes, wait until the input
-        // has settled long enough to count as a real transition.
-
-        if ((save != 0) && (currentState == saveLastIRQState) &&
-            (millis() - saveLastIRQTime > DebounceMs))
-        {
-            // Active-LOW inputs: asserted == LOW, released == HIGH.
-            if (currentState == LOW && SecondaryInputAllowsStart())
-            {
-                Begin();
-            }
-            else if (GetActive())
-            {
-                End();
-            }
-
-            AcknowledgePendingIRQ();
-        }
+        if (asserted)
+            Begin();
+        else if (GetActive())
+            End();
     }
 
     // TimeElapsedTotal
     //
     // Total time event has been running in fractional seconds
 
-    float TimeElapsedTotal() const { return (millis() - _eventStart) / 1000.0f; }
+    float TimeElapsedTotal() const { return (LightingMillis() - _eventStart) / 1000.0f; }
 
     bool GetActive() const { return _active; }
 
@@ -185,7 +142,7 @@ public:
     virtual void Begin()
     {
         if (!_active)
-            _eventStart = millis();
+            _eventStart = LightingMillis();
 
         _active = true;
     };
@@ -193,7 +150,7 @@ public:
     virtual void End()
     {
         _active     = false;
-        _eventStart = millis();
+        _eventStart = LightingMillis();
     };
 
     virtual void Draw() = 0;
@@ -208,10 +165,7 @@ class BackupEvent : public LightingEvent
     static constexpr float BloomTime = 0.25f;
 
 public:
-    BackupEvent(LEDStripGFX* pStrip, uint8_t buttonPin1, uint8_t buttonPin2 = PIN_NONE)
-        : LightingEvent(pStrip, buttonPin1, buttonPin2)
-    {
-    }
+    BackupEvent(LEDStripGFX* pStrip) : LightingEvent(pStrip) {}
 
     void Draw() override
     {
@@ -226,13 +180,9 @@ public:
         int   iFirst           = (NUMBER_USED_PIXELS / 2) - (cLEDs / 2);
         int   iLast            = (NUMBER_USED_PIXELS / 2) + (cLEDs / 2);
 
-        for (int i = 0; i < NUMBER_USED_PIXELS; i++)
-        {
-            if (i < iFirst || i > iLast)
-                _pStrip->drawPixel(i, CRGB::Black);
-            else
-                _pStrip->drawPixel(i, CRGB::White);
-        }
+        _pStrip->FillSpan(0, iFirst, CRGB::Black);
+        _pStrip->FillSpan(iFirst, iLast - iFirst + 1, CRGB::White);
+        _pStrip->FillSpan(iLast + 1, NUMBER_USED_PIXELS - (iLast + 1), CRGB::Black);
     }
 };
 
@@ -245,10 +195,7 @@ class BrakingEvent : public LightingEvent
     static constexpr float BloomTime           = 0.25f;
 
 public:
-    BrakingEvent(LEDStripGFX* pStrip, uint8_t buttonPin1, uint8_t buttonPin2 = PIN_NONE)
-        : LightingEvent(pStrip, buttonPin1, buttonPin2)
-    {
-    }
+    BrakingEvent(LEDStripGFX* pStrip) : LightingEvent(pStrip) {}
 
     // BrakingEvent::Draw
     //
@@ -268,15 +215,16 @@ public:
             float pctComplete   = min(1.0f, (timeElapsed / BloomTime) + BloomStartSize);
             float unusedEachEnd = (1.0f - pctComplete) * NUMBER_USED_PIXELS / 2;
 
-            bool bLit = (millis() / 40) % 2 == 1;
+            bool bLit = (LightingMillis() / 40) % 2 == 1;
 
-            for (uint16_t i = unusedEachEnd; i < NUMBER_USED_PIXELS - unusedEachEnd; i++)
-                _pStrip->drawPixel(i, bLit ? CRGB::Red : CRGB(16, 0, 0));
+            // Every whole pixel index in [unusedEachEnd, NUMBER_USED_PIXELS - unusedEachEnd)
+            const size_t first = unusedEachEnd;
+            const size_t end   = ceilf(NUMBER_USED_PIXELS - unusedEachEnd);
+            _pStrip->FillSpan(first, end - first, bLit ? CRGB::Red : CRGB(16, 0, 0));
         }
         else
         {
-            for (uint16_t i = 1; i < NUMBER_USED_PIXELS; i++)
-                _pStrip->drawPixel(i, CRGB::Red);
+            _pStrip->FillSpan(1, NUMBER_USED_PIXELS - 1, CRGB::Red);
         }
     }
 };
@@ -284,7 +232,8 @@ public:
 // SignalEvent
 //
 // Handles left turns, right turns, and standard hazards (simply both signals at
-// once)
+// once).  A left and right pair set up as hazard partners render the hazard
+// as one effect, phase-locked, rather than as two signals side by side.
 
 class SignalEvent : public LightingEvent
 {
@@ -297,34 +246,167 @@ public:
         Hazard
     };
 
+    enum class Mode : uint8_t
+    {
+        Incandescent = 0, // Blooms in and out through SignalColors_pal, like a bulb
+        Sequential        // All in on the first frame, then sweeps out to the end
+    };
+
 private:
     static constexpr uint32_t FlashDurationMs = 1000;
 
+    // Sequential mode: the SequentialFirstPixels nearest the middle of the
+    // strip light on the first frame of the cycle, the rest follow one at a
+    // time out to the end of the strip over SequentialSweepMs, and the whole
+    // signal goes dark at SequentialOnMs.
+
+    static constexpr size_t   SequentialFirstPixels = 12;
+    static constexpr uint32_t SequentialSweepMs     = 200;
+    static constexpr uint32_t SequentialOnMs        = 500;
+
+    // When each pixel comes on in the cycle, in sweep order (innermost first)
+
+    inline static constexpr std::array<uint16_t, NUMBER_TURN_PIXELS> SequentialOnsetMs = [] {
+        std::array<uint16_t, NUMBER_TURN_PIXELS> onset{};
+        constexpr size_t swept = NUMBER_TURN_PIXELS - SequentialFirstPixels;
+        for (size_t i = SequentialFirstPixels; i < NUMBER_TURN_PIXELS; i++)
+            onset[i] = (i - SequentialFirstPixels + 1) * SequentialSweepMs / swept;
+        return onset;
+    }();
+
     // SetTurnLED
     //
     // Depending on which way the signal is turning, light up it's LED on the
     // correct end of the light strip
 
-    void SetTurnLED(int i, CRGB color)
+    void SetTurnLED(Style style, int i, CRGB color)
     {
         if (i < 0 || i >= NUMBER_TURN_PIXELS)
             return;
 
-        if (_style == Style::RightTurn || _style == Style::Hazard)
+        if (style == Style::RightTurn || style == Style::Hazard)
             _pStrip->drawPixel(i, color);
 
-        if (_style == Style::LeftTurn || _style == Style::Hazard)
+        if (style == Style::LeftTurn || style == Style::Hazard)
             _pStrip->drawPixel(NUMBER_USED_PIXELS - 1 - i, color);
     }
 
+    // FillTurnSpan
+    //
+    // SetTurnLED for a run of count pixels starting at i
+
+    void FillTurnSpan(Style style, size_t i, size_t count, CRGB color)
+    {
+        if (style == Style::RightTurn || style == Style::Hazard)
+            _pStrip->FillSpan(i, count, color);
+
+        if (style == Style::LeftTurn || style == Style::Hazard)
+            _pStrip->FillSpan(NUMBER_USED_PIXELS - i - count, count, color);
+    }
+
     Style _style = Style::Invalid;
+    Mode  _mode  = Mode::Incandescent;
+
+    // Hazard pairing: the left and right signals know each other, and while
+    // both are on, the leader draws both ends and its partner draws nothing
+
+    SignalEvent* _pPartner     = nullptr;
+    bool         _hazardLeader = false;
+
+    // Sequential sweep progress as of the last frame drawn
+
+    size_t   _litPixels   = 0;
+    uint32_t _lastCycleMs = 0;
+
+    // DrawIncandescent
+    //
+    // Every turn pixel gets a palette color, so there's no need to clear them
+    // first.
+
+    void DrawIncandescent(Style style, uint32_t cycleMs)
+    {
+        const float fCyclePosition = cycleMs / static_cast<float>(FlashDurationMs);
+
+        for (int i = 0; i < NUMBER_TURN_PIXELS; i++)
+        {
+            int iPaletteStart = 240 * fCyclePosition; // 240 so that it can "wrap" around inside the
+                                                      // palette at the end seamlessly
+            float iPaletteStep = (NUMBER_USED_PIXELS / NUMBER_TURN_PIXELS) / 3.75f;
+
+            CRGB color = SignalColors_pal[static_cast<uint8_t>(iPaletteStart + i * iPaletteStep)];
+            SetTurnLED(style, i, color);
+        }
+    }
+
+    // DrawSequential
+    //
+    // The lit pixels are always one run from the inner end, so the frame is
+    // two span fills.  The run's length picks up from the last frame and only
+    // steps over the onsets that have passed since, rather than working out
+    // every pixel again.  The fills still write all NUMBER_TURN_PIXELS at each
+    // end every frame, dark run and lit run alike, since the strip is cleared
+    // before the effects draw; the saving is in the onset search, not in the
+    // pixels written.
+
+    void DrawSequential(Style style, uint32_t cycleMs)
+    {
+        if (cycleMs >= SequentialOnMs || cycleMs < _lastCycleMs)
+            _litPixels = 0;
+
+        if (cycleMs < SequentialOnMs)
+            while (_litPixels < NUMBER_TURN_PIXELS && SequentialOnsetMs[_litPixels] <= cycleMs)
+                _litPixels++;
+
+        _lastCycleMs = cycleMs;
+
+        const size_t dark = NUMBER_TURN_PIXELS - _litPixels;
+        FillTurnSpan(style, 0, dark, CRGB::Black);
+        FillTurnSpan(style, dark, _litPixels, AMBERHI);
+    }
+
+    // Expire
+    //
+    // Ends a signal whose last cycle is over.  Returns whether it's still on.
+
+    bool Expire()
+    {
+        if (_exitAtEnd && static_cast<int32_t>(LightingMillis() - _stopAtMs) >= 0)
+        {
+            _active    = false;
+            _exitAtEnd = false;
+        }
+        return _active;
+    }
 
 public:
-    SignalEvent(LEDStripGFX* pStrip, uint8_t buttonPin1, Style style, uint8_t buttonPin2 = PIN_NONE)
-        : LightingEvent(pStrip, buttonPin1, buttonPin2), _style(style)
+    // Pass the left signal as pHazardPartner when constructing the right one
+    // (or the other way around) and the pair draws as one hazard flasher
+    // whenever both are on: both ends flash from one timebase, and the sweep
+    // is only worked out once per frame.
+
+    SignalEvent(LEDStripGFX* pStrip, Style style, Mode mode = Mode::Incandescent,
+                SignalEvent* pHazardPartner = nullptr)
+        : LightingEvent(pStrip), _style(style), _mode(mode), _pPartner(pHazardPartner),
+          _hazardLeader(pHazardPartner != nullptr)
     {
+        if (pHazardPartner)
+            pHazardPartner->_pPartner = this;
     }
 
+    // SetMode
+    //
+    // Switches between Incandescent and Sequential.  A signal that's on picks
+    // up the new mode at its current point in the cycle.
+
+    void SetMode(Mode mode)
+    {
+        _mode        = mode;
+        _litPixels   = 0;
+        _lastCycleMs = 0;
+    }
+
+    Mode GetMode() const { return _mode; }
+
     // Signals are different in that they don't end immediately but instead at the
     // end of their cycle.  So when and End() is called we just keep track of that
     // fact so that we know any subsequent Begins() that come in after an End()
@@ -338,17 +420,27 @@ public:
         if (!_active || _exitAtEnd)
             return;
 
-        const uint32_t elapsedMs   = millis() - _eventStart;
+        const uint32_t elapsedMs   = LightingMillis() - _eventStart;
         const uint32_t remainingMs = FlashDurationMs - (elapsedMs % FlashDurationMs);
 
         _exitAtEnd = true;
-        _stopAtMs  = millis() + remainingMs;
+        _stopAtMs  = LightingMillis() + remainingMs;
     };
 
+    // Begin
+    //
+    // A signal that starts while its hazard partner is already on joins the
+    // partner's cycle rather than starting its own, so the two ends can never
+    // flash out of phase.
+
     void Begin() override
     {
         if (!_active || _exitAtEnd)
-            _eventStart = millis();
+        {
+            _eventStart  = _pPartner && _pPartner->_active ? _pPartner->_eventStart : LightingMillis();
+            _litPixels   = 0;
+            _lastCycleMs = 0;
+        }
 
         _active    = true;
         _exitAtEnd = false;
@@ -356,32 +448,31 @@ public:
 
     void Draw() override
     {
-        if (false == GetActive())
+        if (!Expire())
             return;
 
-        if (_exitAtEnd && static_cast<int32_t>(millis() - _stopAtMs) >= 0)
+        // Both on is the hazard flasher, drawn by the leader at both ends.
+        // The partner's sweep state goes stale meanwhile, so it's cleared
+        // for the partner to start afresh if the leader goes off first.
+
+        Style style = _style;
+        if (_pPartner && _pPartner->Expire())
         {
-            _active    = false;
-            _exitAtEnd = false;
-            return;
+            if (!_hazardLeader)
+            {
+                _litPixels   = 0;
+                _lastCycleMs = 0;
+                return;
+            }
+            style = Style::Hazard;
         }
 
-        const uint32_t elapsedMs = millis() - _eventStart;
-        const float    fCyclePosition =
-            (elapsedMs % FlashDurationMs) / static_cast<float>(FlashDurationMs);
-
-        for (int i = 0; i < NUMBER_TURN_PIXELS; i++)
-            SetTurnLED(i, CRGB::Black);
-
-        for (int i = 0; i < NUMBER_TURN_PIXELS; i++)
-        {
-            int iPaletteStart = 240 * fCyclePosition; // 240 so that it can "wrap" around inside the
-                                                      // palette at the end seamlessly
-            float iPaletteStep = (NUMBER_USED_PIXELS / NUMBER_TURN_PIXELS) / 3.75f;
+        const uint32_t cycleMs = (LightingMillis() - _eventStart) % FlashDurationMs;
 
-            CRGB color = ColorFromPalette(SignalColors_pal, iPaletteStart + i * iPaletteStep);
-            SetTurnLED(i, color);
-        }
+        if (_mode == Mode::Sequential)
+            DrawSequential(style, cycleMs);
+        else
+            DrawIncandescent(style, cycleMs);
     }
 };
 
@@ -401,7 +492,7 @@ class PoliceLightBar : public LightingEvent
     inline static constexpr float LongPulse  = 0.30f;
     inline static constexpr float ShortPulse = 0.04f;
 
-    inline static const std::array<PoliceLightBarState, 25> PoliceBarStates = {{
+    inline static constexpr std::array<PoliceLightBarState, 25> PoliceBarStates = {{
         {{CRGB::Blue, CRGB::Blue, CRGB::Red, CRGB::Red, CRGB::Blue, CRGB::Blue, CRGB::Red,
           CRGB::Red},
          LongPulse},
@@ -480,15 +571,15 @@ class PoliceLightBar : public LightingEvent
          ShortPulse},
     }};
 
-    float _totalCycleTime = 0.0f;
+    inline static constexpr float TotalCycleTime = [] {
+        float total = 0.0f;
+        for (const auto& state : PoliceBarStates)
+            total += state.duration;
+        return total;
+    }();
 
 public:
-    PoliceLightBar(LEDStripGFX* pStrip, uint8_t buttonPin1, uint8_t buttonPin2 = PIN_NONE)
-        : LightingEvent(pStrip, buttonPin1, buttonPin2)
-    {
-        for (const auto& state : PoliceBarStates)
-            _totalCycleTime += state.duration;
-    }
+    PoliceLightBar(LEDStripGFX* pStrip) : LightingEvent(pStrip) {}
 
     void Begin() override
     {
@@ -505,7 +596,7 @@ public:
         if (false == GetActive())
             return;
 
-        float        fCyclePosition = fmod(TimeElapsedTotal(), _totalCycleTime);
+        float        fCyclePosition = fmod(TimeElapsedTotal(), TotalCycleTime);
         const size_t sectionSize    = NUMBER_USED_PIXELS / 8;
 
         // Find out which row of the table we're in based on how far into the
@@ -520,13 +611,14 @@ public:
             row++;
         }
 
-        // Draw the current frame
+        // Draw the current frame, one span per section.  The last section
+        // picks up any pixels left over by the division.
 
-        for (uint16_t i = 0; i < NUMBER_USED_PIXELS; i++)
+        for (size_t iSection = 0; iSection < 8; iSection++)
         {
-            int            iSection = i / sectionSize;
-            const uint32_t color    = PoliceBarStates[row].sectionColor[iSection];
-            _pStrip->drawPixel(i, color);
+            const size_t first = iSection * sectionSize;
+            const size_t count = iSection == 7 ? NUMBER_USED_PIXELS - first : sectionSize;
+            _pStrip->FillSpan(first, count, PoliceBarStates[row].sectionColor[iSection]);
         }
     }
 };
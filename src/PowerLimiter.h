@@ -0,0 +1,68 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        PowerLimiter.h
+//
+// Description:
+//
+//   Keeps the strip inside a current budget.  The estimate comes straight
+//   from the running channel totals that LEDStripGFX maintains as effects
+//   draw, so limiting costs a few multiplies per frame instead of a rescan
+//   of every pixel the way FastLED's own power limiter does it.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "LEDStripGFX.h"
+
+class PowerLimiter
+{
+public:
+    // WS2812B figures: one channel at full drive, and the controller's draw
+    // with all channels off.
+    static constexpr uint32_t MilliampsPerChannel = 20;
+    static constexpr uint32_t IdleMilliampsPerLED = 1;
+
+private:
+    uint32_t _budgetMilliamps;
+    uint32_t _estimateMilliamps = 0; // Estimated draw of the last frame at the brightness chosen
+    bool     _limited           = false;
+
+public:
+    explicit PowerLimiter(uint32_t budgetMilliamps) : _budgetMilliamps(budgetMilliamps) {}
+
+    // Limit
+    //
+    // Returns the highest brightness, up to requested, at which the frame
+    // currently in the strip fits the budget.  The result is never below
+    // minimum, which is how safety-critical effects (brake red) keep their
+    // legal intensity even if that means going over budget.
+
+    uint8_t Limit(const LEDStripGFX& strip, uint8_t requested, uint8_t minimum = 0)
+    {
+        const auto&    totals    = strip.GetChannelTotals();
+        const uint32_t idleMa    = IdleMilliampsPerLED * strip.GetLEDCount();
+        const uint64_t fullScale = static_cast<uint64_t>(totals[0]) + totals[1] + totals[2];
+
+        // Draw above idle at brightness 255, scaled back down by requested/255
+        const uint32_t dynamicMa = fullScale * MilliampsPerChannel / 255;
+
+        uint8_t brightness = requested;
+        if (dynamicMa > 0 && idleMa + dynamicMa * requested / 255 > _budgetMilliamps)
+        {
+            const uint32_t headroomMa = _budgetMilliamps > idleMa ? _budgetMilliamps - idleMa : 0;
+            brightness                = min<uint32_t>(requested, headroomMa * 255 / dynamicMa);
+        }
+
+        brightness         = max(brightness, minimum);
+        _limited           = brightness < requested;
+        _estimateMilliamps = idleMa + dynamicMa * brightness / 255;
+        return brightness;
+    }
+
+    uint32_t GetEstimateMilliamps() const { return _estimateMilliamps; }
+    bool     IsLimiting() const { return _limited; }
+};
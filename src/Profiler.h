@@ -0,0 +1,121 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Profiler.h
+//
+// Description:
+//
+//   Scoped CPU cycle-counter probes for finding out where a frame's time
+//   goes.  Each probe accumulates min/avg/max and a log2 histogram in static
+//   storage, so probing never allocates.  Build with -DENABLE_PROFILER=1 to
+//   turn it on; otherwise PROFILE_SCOPE compiles to nothing.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <Arduino.h>
+#include <array>
+
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+
+#if ENABLE_PROFILER
+
+// ProfileStats
+//
+// Running statistics for one probe.  Histogram bucket n counts samples that
+// took [2^n, 2^(n+1)) cycles.
+
+struct ProfileStats
+{
+    uint32_t                 count       = 0;
+    uint32_t                 minCycles   = UINT32_MAX;
+    uint32_t                 maxCycles   = 0;
+    uint64_t                 totalCycles = 0;
+    std::array<uint32_t, 32> histogram{};
+
+    void Add(uint32_t cycles)
+    {
+        count++;
+        totalCycles += cycles;
+        minCycles    = min(minCycles, cycles);
+        maxCycles    = max(maxCycles, cycles);
+        histogram[31 - __builtin_clz(cycles | 1)]++;
+    }
+};
+
+// Profiler
+//
+// A fixed set of N probes.  Only the render loop adds samples; Dump() may be
+// called from another task, in which case a probe being updated at that
+// moment can print slightly torn numbers, which is fine for diagnostics.
+
+template <size_t N> class Profiler
+{
+    std::array<ProfileStats, N> _stats{};
+
+public:
+    ProfileStats& Stats(size_t probe) { return _stats[probe]; }
+
+    void Reset() { _stats.fill(ProfileStats()); }
+
+    void Dump(const std::array<const char*, N>& names) const
+    {
+        const float cyclesPerUs = ESP.getCpuFreqMHz();
+
+        Serial.println("Probe                  count     min us     avg us     max us");
+        for (size_t i = 0; i < N; i++)
+        {
+            const ProfileStats& stats = _stats[i];
+            if (stats.count == 0)
+            {
+                Serial.printf("%-18s %9u          -          -          -\n", names[i], 0u);
+                continue;
+            }
+
+            Serial.printf("%-18s %9lu %10.1f %10.1f %10.1f\n", names[i], (unsigned long)stats.count,
+                          stats.minCycles / cyclesPerUs,
+                          stats.totalCycles / stats.count / cyclesPerUs,
+                          stats.maxCycles / cyclesPerUs);
+
+            Serial.print("    cycles histogram:");
+            for (size_t bucket = 0; bucket < stats.histogram.size(); bucket++)
+                if (stats.histogram[bucket])
+                    Serial.printf(" 2^%u:%lu", (unsigned)bucket,
+                                  (unsigned long)stats.histogram[bucket]);
+            Serial.println();
+        }
+    }
+};
+
+// ProfileScope
+//
+// Adds the cycles spent between construction and destruction to a probe.
+
+class ProfileScope
+{
+    ProfileStats& _stats;
+    uint32_t      _startCycles;
+
+public:
+    explicit ProfileScope(ProfileStats& stats) : _stats(stats), _startCycles(ESP.getCycleCount())
+    {
+    }
+
+    ~ProfileScope() { _stats.Add(ESP.getCycleCount() - _startCycles); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(profiler, probe)                                                            \
+    ProfileScope PROFILE_CONCAT(_profileScope, __LINE__)((profiler).Stats(probe))
+
+#else
+
+#define PROFILE_SCOPE(profiler, probe)
+
+#endif // ENABLE_PROFILER
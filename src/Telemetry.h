@@ -0,0 +1,132 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Telemetry.h
+//
+// Description:
+//
+//   Fixed-size, lock-free ring of compact binary telemetry records.  The
+//   render loop drops records in without ever blocking, and a low-priority
+//   task drains them out to the serial port, where tools/telemetry_decode.py
+//   turns a capture back into CSV.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// TelemetryKind
+//
+// What a record describes.  The meaning of the detail and value fields depends
+// on the kind; see TelemetryRecord below.
+
+enum class TelemetryKind : uint8_t
+{
+    Frame = 0, // value = frame time (us)
+    DemoMode,  // detail = 1 if demo mode turned on, 0 if off
+    DemoStep,  // detail = DemoStep index
+    Sleep,     // entering light sleep
+    Wake,      // detail = esp_sleep_wakeup_cause_t, inputs = asserted at wake, value = wake-to-photon (us)
+    Dropped,   // value = number of records lost because the ring was full
+    Overrun,   // detail = OverrunCause, value = frame time (us)
+    Stall,     // detail = FramePhase stuck in, frame = stuck frame, value = time into it (us)
+};
+
+// TelemetryRecord
+//
+// One 24-byte record.  Layout is fixed (little-endian, packed) because the
+// host decoder unpacks it byte for byte - update tools/telemetry_decode.py if
+// you change it.
+
+struct __attribute__((packed)) TelemetryRecord
+{
+    uint8_t  kind;     // TelemetryKind
+    uint8_t  detail;   // Kind-specific small argument
+    uint8_t  inputs;   // InputBit mask of asserted inputs
+    uint8_t  active;   // Bit n set if g_AllEffects[n] is active
+    uint32_t timeMs;   // millis() when the record was written
+    uint32_t frame;    // Render loop frame number
+    uint32_t value;    // Kind-specific argument
+    uint16_t irqs[4];  // Low 16 bits of the L, R, Bk, E input event counts
+};
+
+static_assert(sizeof(TelemetryRecord) == 24, "Host decoder expects 24-byte records");
+
+// TelemetryRing
+//
+// Single-producer, single-consumer ring.  Only the render loop task may call
+// Push(), and only the drain task may call Pop().  When the ring is full new
+// records are counted and discarded rather than waiting for the consumer.
+
+template <typename T, size_t N> class TelemetryRing
+{
+    static_assert((N & (N - 1)) == 0, "Ring size must be a power of two");
+
+    std::array<T, N>      _records{};
+    std::atomic<uint32_t> _head{0}; // Next slot to write; owned by the producer
+    std::atomic<uint32_t> _tail{0}; // Next slot to read; owned by the consumer
+    std::atomic<uint32_t> _dropped{0};
+
+public:
+    bool Push(const T& record)
+    {
+        const uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _records[head & (N - 1)] = record;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& record)
+    {
+        const uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return false;
+
+        record = _records[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns the number of records dropped since the last call and resets it
+    uint32_t TakeDropped() { return _dropped.exchange(0, std::memory_order_relaxed); }
+};
+
+// EncodeTelemetryLine
+//
+// Formats a record as "@T <hex bytes>\n" so that it can share the serial port
+// with ordinary text logging; the decoder ignores any line without the
+// prefix.  Returns the number of characters written, excluding the NUL.
+
+inline constexpr size_t TelemetryLineLength = 3 + sizeof(TelemetryRecord) * 2 + 1;
+
+inline size_t EncodeTelemetryLine(const TelemetryRecord& record,
+                                  char (&line)[TelemetryLineLength + 1])
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+    size_t      pos   = 0;
+
+    line[pos++] = '@';
+    line[pos++] = 'T';
+    line[pos++] = ' ';
+    for (size_t i = 0; i < sizeof(record); i++)
+    {
+        line[pos++] = hex[bytes[i] >> 4];
+        line[pos++] = hex[bytes[i] & 0x0F];
+    }
+    line[pos++] = '\n';
+    line[pos]   = '\0';
+    return pos;
+}
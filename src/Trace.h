@@ -0,0 +1,134 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Trace.h
+//
+// Description:
+//
+//   Lightweight timeline tracing of the render loop, the UI task and the
+//   input IRQs.  Events (begin, end or instant) are stamped with micros()
+//   and the core they ran on and go into a preallocated buffer.  A capture is
+//   armed from the serial monitor, runs until the buffer fills, and is then
+//   dumped as text that tools/trace_to_chrome.py turns into Chrome trace
+//   JSON (chrome://tracing or ui.perfetto.dev).
+//
+//   Build with -DENABLE_TRACE=1 to turn it on; otherwise the TRACE_ macros
+//   compile to nothing.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+#ifndef ENABLE_TRACE
+#define ENABLE_TRACE 0
+#endif
+
+#if ENABLE_TRACE
+
+struct TraceEvent
+{
+    uint32_t timeUs; // micros() when recorded; 0 means the slot was never written
+    uint8_t  id;     // Index into the caller's name table
+    char     phase;  // 'B'egin, 'E'nd or 'i'nstant, as in the Chrome trace format
+    uint8_t  core;   // Core the event was recorded on
+};
+
+// TraceBuffer
+//
+// Any task or ISR, on either core, may call Record().  A slot is claimed with
+// a single atomic increment so writers never wait on each other; once the
+// buffer is full, recording stops until the next Start().
+
+template <size_t N> class TraceBuffer
+{
+    std::array<TraceEvent, N> _events{};
+    std::atomic<uint32_t>     _next{0};
+    std::atomic<bool>         _armed{false};
+
+public:
+    void Start()
+    {
+        _armed = false;
+        _events.fill(TraceEvent());
+        _next  = 0;
+        _armed = true;
+    }
+
+    void Stop() { _armed = false; }
+
+    bool IsArmed() const { return _armed; }
+
+    bool IsFull() const { return _next.load(std::memory_order_relaxed) >= N; }
+
+    inline void Record(uint8_t id, char phase)
+    {
+        if (!_armed.load(std::memory_order_relaxed))
+            return;
+
+        const uint32_t slot = _next.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= N)
+        {
+            _armed = false;
+            return;
+        }
+
+        TraceEvent& event = _events[slot];
+        event.id          = id;
+        event.phase       = phase;
+        event.core        = xPortGetCoreID();
+        event.timeUs      = micros();
+    }
+
+    // Dump
+    //
+    // Writes one "@X <us> <phase> <core> <name>" line per event.  Call with
+    // the buffer stopped.
+
+    template <size_t Names> void Dump(const std::array<const char*, Names>& names) const
+    {
+        const uint32_t count = min<uint32_t>(_next.load(), N);
+
+        Serial.printf("@X begin %lu\n", (unsigned long)count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const TraceEvent& event = _events[i];
+            if (event.timeUs == 0 || event.id >= Names)
+                continue;
+            Serial.printf("@X %lu %c %u %s\n", (unsigned long)event.timeUs, event.phase,
+                          event.core, names[event.id]);
+        }
+        Serial.println("@X end");
+    }
+};
+
+// TraceScope
+//
+// Records a begin event on construction and the matching end on destruction.
+
+template <typename Buffer> class TraceScope
+{
+    Buffer& _buffer;
+    uint8_t _id;
+
+public:
+    TraceScope(Buffer& buffer, uint8_t id) : _buffer(buffer), _id(id) { _buffer.Record(_id, 'B'); }
+    ~TraceScope() { _buffer.Record(_id, 'E'); }
+};
+
+#define TRACE_CONCAT_(a, b)      a##b
+#define TRACE_CONCAT(a, b)       TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(buffer, id)  TraceScope<decltype(buffer)> TRACE_CONCAT(_traceScope, __LINE__)(buffer, id)
+#define TRACE_INSTANT(buffer, id) (buffer).Record(id, 'i')
+
+#else
+
+#define TRACE_SCOPE(buffer, id)
+#define TRACE_INSTANT(buffer, id)
+
+#endif // ENABLE_TRACE
@@ -1,6 +1,9 @@
 
 #pragma once
 #include <Arduino.h>
+#include <array>
+#include <atomic>
+#include <esp_timer.h>
 
 inline constexpr uint16_t MATRIX_WIDTH  = (144+80);
 inline constexpr uint16_t MATRIX_HEIGHT = 1;
@@ -13,6 +16,17 @@ inline constexpr uint8_t BACKUP_PIN     = 6;
 inline constexpr uint8_t EMERGENCY_PIN  = 7;
 inline constexpr uint8_t DEMO_PIN       = 0;   // Heltec V3 on-board PRG (BOOT) button
 
+inline constexpr uint8_t AMBIENT_LIGHT_PIN = 3; // ADC1 channel 2, photo-transistor divider
+
+inline constexpr uint8_t SR_LOAD_PIN  = 38; // 74HC165 input shift register, when fitted
+inline constexpr uint8_t SR_CLOCK_PIN = 39;
+inline constexpr uint8_t SR_DATA_PIN  = 40;
+
+inline constexpr uint8_t CAN_TX_PIN = 47; // To the CAN transceiver (TWAI, listen-only)
+inline constexpr uint8_t CAN_RX_PIN = 48;
+
+inline constexpr uint8_t SYNC_PIN = 41; // Wired sync line between controllers, when fitted
+
 // Sentinel for "no pin assigned" - real GPIO 0 is the PRG button on Heltec V3,
 // so we cannot use 0 as the unused-pin sentinel.
 inline constexpr uint8_t PIN_NONE = 0xFF;
@@ -22,7 +36,59 @@ inline constexpr uint16_t NUMBER_TURN_PIXELS = 87;
 
 inline constexpr uint16_t BLACK16 = 0x0000;
 
+// Input levels and time as seen by the lighting logic.  Normally these are
+// just the real pins and millis(), but while an input trace is being replayed
+// (see InputReplay.h) they come from the trace and its virtual clock instead.
+
+inline volatile bool g_InputReplayActive = false;
+inline uint32_t      g_ReplayMs          = 0;
+inline uint64_t      g_ReplayPinLevels   = ~0ULL; // Bit n is the level of GPIO n
+
+// When this controller follows another's sync pulses (see ClockSync.h),
+// lighting time is the master's timebase instead: esp_timer time mapped
+// through the latest LightingClockMap.  There are two maps so that the one
+// being read, possibly from an IRQ, is never the one being written.
+
+struct LightingClockMap
+{
+    int64_t refLocalUs  = 0; // esp_timer time the map was anchored at
+    int64_t refSyncedUs = 0; // Lighting time at that moment
+    int64_t rateQ32     = 0; // Lighting minus local rate, as a fraction scaled by 2^32
+};
+
+inline std::array<LightingClockMap, 2> g_LightingClockMaps{};
+inline std::atomic<uint8_t>            g_LightingClockMap{0}; // The one to read
+inline volatile bool                   g_LightingClockSynced = false;
+
+inline int64_t MapLightingClock(const LightingClockMap& map, int64_t localUs)
+{
+    const int64_t elapsedUs = localUs - map.refLocalUs;
+    return map.refSyncedUs + elapsedUs + (elapsedUs * map.rateQ32 >> 32);
+}
+
+inline uint32_t LightingMillis()
+{
+    if (g_InputReplayActive)
+        return g_ReplayMs;
+
+    if (g_LightingClockSynced)
+    {
+        const LightingClockMap& map = g_LightingClockMaps[g_LightingClockMap.load(std::memory_order_acquire)];
+        return static_cast<uint32_t>(MapLightingClock(map, esp_timer_get_time()) / 1000);
+    }
+
+    return millis();
+}
+
+inline int ReadInputPin(uint8_t pin)
+{
+    if (g_InputReplayActive)
+        return (g_ReplayPinLevels >> pin) & 1 ? HIGH : LOW;
+
+    return digitalRead(pin);
+}
+
 inline bool IsInputPressed(uint8_t pin)
 {
-    return digitalRead(pin) == LOW;
+    return ReadInputPin(pin) == LOW;
 }
@@ -3,22 +3,62 @@
 #include <Arduino.h>
 #define FASTLED_INTERNAL 1 // Quiet the FastLED compiler banner
 #include "./LEDStripGFX.h"
+#include "./InputReplay.h"
+#include "./InputSource.h"
+#include "./InputStress.h"
+#include "./CanInput.h"
+#include "./ClockSync.h"
+#include "./FrameMonitor.h"
+#include "./HeapGuard.h"
+#include "./LifetimeStats.h"
 #include "./LightingEvents.h"
+#include "./PowerLimiter.h"
+#include "./Profiler.h"
+#include "./Telemetry.h"
+#include "./Trace.h"
 #include "./globals.h"
 #include <FastLED.h> // FastLED for the LED panels
 #include <array>
+#include <driver/gpio.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <heltec.h>
 #include <pixeltypes.h> // Handy color and hue stuff
 
+// Set to 1 when the vehicle inputs come in through a 74HC165 shift register
+// on SR_LOAD_PIN, SR_CLOCK_PIN and SR_DATA_PIN instead of a GPIO each.  Only
+// the demo button stays on a GPIO.  The heltec_wifi_kit_32_V3_shiftregister
+// environment builds with it on.
+#ifndef ENABLE_SHIFT_REGISTER_INPUT
+#define ENABLE_SHIFT_REGISTER_INPUT 0
+#endif
+
 // Set to 0 while debugging - light sleep will drop the USB-CDC serial monitor.
-#define ENABLE_SLEEP 1
+// Off by default with the shift register, which can't wake us.
+#ifndef ENABLE_SLEEP
+#define ENABLE_SLEEP !ENABLE_SHIFT_REGISTER_INPUT
+#endif
 
 #if ENABLE_SLEEP
-#include <driver/gpio.h>
 #include <esp_sleep.h>
 constexpr uint32_t IDLE_SLEEP_MS = 30000;
 #endif
 
+// Set to 1 when a light sensor is wired to AMBIENT_LIGHT_PIN; brightness then
+// follows the ambient light instead of sitting at g_Brightness.  The
+// heltec_wifi_kit_32_V3_ambientlight environment builds with it on.
+#ifndef ENABLE_AMBIENT_LIGHT
+#define ENABLE_AMBIENT_LIGHT 0
+#endif
+
+#if ENABLE_AMBIENT_LIGHT
+#include "./AmbientLight.h"
+#endif
+
+#if ENABLE_SHIFT_REGISTER_INPUT && ENABLE_SLEEP
+#error "Light sleep wakes on the input GPIOs; set ENABLE_SLEEP to 0 with the shift register"
+#endif
+
 // Global brightness scalar - everthing you do is ultimately multiplied by this
 // fraction of 255
 
@@ -26,357 +66,2314 @@ constexpr byte     g_Brightness            = 255;
 constexpr uint32_t DiagnosticFrameInterval = 50;
 constexpr float    BrakeDetectionWindow    = 0.05f;
 
-LEDStripGFX g_Strip(NUMBER_USED_PIXELS);
+// The strip's output stage (see LEDStripGFX.h).  The effects' colors were
+// picked by eye as raw values on this strip, so they go out as drawn, with
+// no color correction; FastLED scales them by the brightness and dithers
+// what that scaling loses.  Retune the colors before changing it.
+
+constexpr uint32_t StripColorCorrection = UncorrectedColor;
+
+// Most current the supply and wiring can deliver to the strip, and the lowest
+// brightness the brake light may be dimmed to in order to stay within it.
+
+constexpr uint32_t PowerBudgetMilliamps = 4000;
+constexpr byte     MinBrakeBrightness   = 128;
+
+// Frame deadline and per-phase budgets for the frame monitor.  Show is the
+// WS2812 wire time (30 us per LED plus the latch) with some slack, so it
+// follows the strip length.  A frame still running at FrameStallUs is
+// reported as a stall; BrakingEvent may legitimately hold a frame for 50 ms.
+
+constexpr uint32_t FrameDeadlineUs = 20000;
+constexpr uint32_t FrameStallUs    = 250000;
+
+constexpr std::array<uint32_t, FramePhaseCount> FramePhaseBudgetUs = 
+{
+    1000,                            // Input
+    8000,                            // Render
+    NUMBER_USED_PIXELS * 30 + 1000,  // Show
+};
+
+// Incandescent turn signals bloom in like the bulbs they replace; Sequential
+// ones light their inner segment on the very first frame and sweep outward,
+// the way LED signals are expected to.  Set SEQUENTIAL_TURN_SIGNALS to 1 (the
+// heltec_wifi_kit_32_V3_sequential environment does) for Sequential.
+
+#ifndef SEQUENTIAL_TURN_SIGNALS
+#define SEQUENTIAL_TURN_SIGNALS 0
+#endif
+
+constexpr SignalEvent::Mode g_SignalMode =
+    SEQUENTIAL_TURN_SIGNALS ? SignalEvent::Mode::Sequential : SignalEvent::Mode::Incandescent;
+
+LEDStripGFX  g_Strip(NUMBER_USED_PIXELS);
+PowerLimiter g_PowerLimiter(PowerBudgetMilliamps);
+FrameMonitor g_FrameMonitor(FrameDeadlineUs, FramePhaseBudgetUs, FrameStallUs);
+
+BrakingEvent   g_Braking(&g_Strip);
+BackupEvent    g_Backup(&g_Strip);
+SignalEvent    g_LeftTurn(&g_Strip, SignalEvent::Style::LeftTurn, g_SignalMode);
+SignalEvent    g_RightTurn(&g_Strip, SignalEvent::Style::RightTurn, g_SignalMode, &g_LeftTurn);
+PoliceLightBar g_Emergency(&g_Strip);
+
+const std::array<LightingEvent*, 5> g_AllEffects = 
+{
+    &g_Emergency, &g_Braking, &g_LeftTurn, &g_RightTurn, &g_Backup,
+};
+
+constexpr size_t EffectCount = std::tuple_size<decltype(g_AllEffects)>::value;
+
+const std::array<const char*, EffectCount> g_EffectNames = 
+{
+    "Emergency", "Braking", "LeftTurn", "RightTurn", "Backup",
+};
+
+// Statistics for the life of the light, kept in NVS (see LifetimeStats.h)
+
+NvsStatsStorage            g_StatsStorage;
+LifetimeStats<EffectCount> g_LifetimeStats(g_StatsStorage);
+
+// Lifetime statistics are saved just before light sleep.  Set this to 1 to
+// also save them after LifetimeFlushIdleMs with nothing lit and no input.
+// It's off by default because the save stalls the render task for a few ms
+// and idle while driving is just when a brake press can come in; builds
+// with ENABLE_SLEEP at 0 need it to save at all.
+#ifndef LIFETIME_IDLE_FLUSH
+#define LIFETIME_IDLE_FLUSH 0
+#endif
+
+#if LIFETIME_IDLE_FLUSH
+constexpr uint32_t LifetimeFlushIdleMs = 5000;
+#endif
+
+// The most one frame can add to effect on-time.  A longer gap between
+// frames was spent asleep or in a diagnostic, not lit.
+constexpr uint32_t LifetimeMaxFrameMs = 5 * FrameDeadlineUs / 1000;
+
+// The effect each input signal drives, in InputSignal order
+
+const std::array<LightingEvent*, InputSignalCount> g_SignalEffects = 
+{
+    &g_LeftTurn, &g_RightTurn, &g_Braking, &g_Backup, &g_Emergency, nullptr,
+};
+
+// Lowest brightness each effect may be dimmed to by the ambient light, in
+// g_AllEffects order, so that signals and brake stay visible at night.
+
+constexpr std::array<byte, EffectCount> g_EffectMinBrightness = 
+{
+    0, MinBrakeBrightness, 96, 96, 128,
+};
+
+// Where the vehicle broadcasts brake, turn and reverse on its CAN bus.  The
+// ids and bits are vehicle specific; this is an example layout, so sniff
+// your own bus and fill them in before building with ENABLE_CAN_INPUT.
+
+constexpr uint16_t CanBrakeFrameId  = 0x0A0;
+constexpr uint16_t CanLightsFrameId = 0x0A8;
+
+constexpr std::array<CanSignalMap, 4> g_CanSignals = 
+{{
+    {CanBrakeFrameId,  0, 0x01, InputSignal::Brake},
+    {CanLightsFrameId, 1, 0x01, InputSignal::Left},
+    {CanLightsFrameId, 1, 0x02, InputSignal::Right},
+    {CanLightsFrameId, 2, 0x10, InputSignal::Reverse},
+}};
+
+#if ENABLE_AMBIENT_LIGHT
+// On the S3, GPIO n (1-10) is ADC1 channel n-1
+AmbientLight g_AmbientLight(static_cast<adc1_channel_t>(AMBIENT_LIGHT_PIN - 1), g_Brightness);
+#endif
+
+#if ENABLE_TRACE
+
+// Trace event ids and their names.  Names are "track:event"; the host tool
+// puts each track on its own row.
+
+enum TraceId : uint8_t
+{
+    TraceFrame = 0,
+    TraceInput,
+    TraceDraw,
+    TraceShow,
+    TraceUIDraw,
+    TraceTelemetry,
+    TraceIRQLeft,
+    TraceIRQRight,
+    TraceIRQBackup,
+    TraceIRQEmergency,
+    TraceIRQDemo,
+    TraceIdCount
+};
+
+const std::array<const char*, TraceIdCount> g_TraceNames = 
+{
+    "render:Frame", "render:Input", "render:Draw", "render:Show", "ui:Draw", "telemetry:Drain",
+    "irq:Left", "irq:Right", "irq:Backup", "irq:Emergency", "irq:Demo",
+};
+
+TraceBuffer<2048> g_Trace;
+
+#endif
+
+#if ENABLE_PROFILER
+
+// Profiler probes for processAndDisplayInputs().  There's one Draw probe per
+// entry in g_AllEffects, in the same order.
+
+enum ProfileProbe : size_t
+{
+    ProbeFrame = 0,
+    ProbeInput,
+    ProbeClear,
+    ProbeDraw,
+    ProbeBrightness = ProbeDraw + EffectCount,
+    ProbeShow,
+    ProbeCount
+};
+
+const std::array<const char*, ProbeCount> g_ProbeNames = 
+{
+    "Frame", "Input", "Clear", "Draw Emergency", "Draw Braking", "Draw LeftTurn",
+    "Draw RightTurn", "Draw Backup", "Brightness", "Show",
+};
+
+Profiler<ProbeCount> g_Profiler;
+
+#endif
+
+#if ENABLE_HEAP_GUARD
+
+// Heap calls made on the real-time path (see HeapGuard.h)
+
+HeapGuard<64> g_HeapGuard;
+
+// The heap guard environment links with -Wl,--wrap for each allocator entry
+// point below, so every call to one anywhere in the image lands in its
+// __wrap_ function, which reports it and forwards to the __real_ one.
+// Besides the standard calls, newlib's stdio allocates through the reentrant
+// _r versions and IDF drivers call heap_caps_malloc directly.
+
+struct _reent;
+
+extern "C"
+{
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+    void  __real_free(void* ptr);
+    void* __real__malloc_r(_reent* reent, size_t size);
+    void* __real__calloc_r(_reent* reent, size_t count, size_t size);
+    void* __real__realloc_r(_reent* reent, void* ptr, size_t size);
+    void  __real__free_r(_reent* reent, void* ptr);
+    void* __real_heap_caps_malloc(size_t size, uint32_t caps);
+    void  __real_heap_caps_free(void* ptr);
+
+    void* IRAM_ATTR __wrap_malloc(size_t size)
+    {
+        g_HeapGuard.Record('m', size, __builtin_return_address(0));
+        return __real_malloc(size);
+    }
+
+    void* IRAM_ATTR __wrap_calloc(size_t count, size_t size)
+    {
+        g_HeapGuard.Record('c', count * size, __builtin_return_address(0));
+        return __real_calloc(count, size);
+    }
+
+    void* IRAM_ATTR __wrap_realloc(void* ptr, size_t size)
+    {
+        g_HeapGuard.Record('r', size, __builtin_return_address(0));
+        return __real_realloc(ptr, size);
+    }
+
+    void IRAM_ATTR __wrap_free(void* ptr)
+    {
+        if (ptr)
+            g_HeapGuard.Record('f', 0, __builtin_return_address(0));
+        __real_free(ptr);
+    }
+
+    void* IRAM_ATTR __wrap__malloc_r(_reent* reent, size_t size)
+    {
+        g_HeapGuard.Record('m', size, __builtin_return_address(0));
+        return __real__malloc_r(reent, size);
+    }
+
+    void* IRAM_ATTR __wrap__calloc_r(_reent* reent, size_t count, size_t size)
+    {
+        g_HeapGuard.Record('c', count * size, __builtin_return_address(0));
+        return __real__calloc_r(reent, count, size);
+    }
+
+    void* IRAM_ATTR __wrap__realloc_r(_reent* reent, void* ptr, size_t size)
+    {
+        g_HeapGuard.Record('r', size, __builtin_return_address(0));
+        return __real__realloc_r(reent, ptr, size);
+    }
+
+    void IRAM_ATTR __wrap__free_r(_reent* reent, void* ptr)
+    {
+        if (ptr)
+            g_HeapGuard.Record('f', 0, __builtin_return_address(0));
+        __real__free_r(reent, ptr);
+    }
+
+    void* IRAM_ATTR __wrap_heap_caps_malloc(size_t size, uint32_t caps)
+    {
+        g_HeapGuard.Record('m', size, __builtin_return_address(0));
+        return __real_heap_caps_malloc(size, caps);
+    }
+
+    void IRAM_ATTR __wrap_heap_caps_free(void* ptr)
+    {
+        if (ptr)
+            g_HeapGuard.Record('f', 0, __builtin_return_address(0));
+        __real_heap_caps_free(ptr);
+    }
+}
+
+#endif
+
+// Every edge on the effect inputs is kept in this ring so that real vehicle
+// timing can be exported and replayed (see InputReplay.h).
+
+InputRecorder<1024> g_InputRecorder;
+
+// OnInputEdge
+//
+// Called from the GPIO input IRQs with every edge.  Edges on the effect
+// inputs are recorded for export and replay; the demo button's aren't.
+
+static void IRAM_ATTR OnInputEdge(InputSignal signal, uint8_t pin, int level)
+{
+    switch (signal)
+    {
+        case InputSignal::Left:      TRACE_INSTANT(g_Trace, TraceIRQLeft);      break;
+        case InputSignal::Right:     TRACE_INSTANT(g_Trace, TraceIRQRight);     break;
+        case InputSignal::Reverse:   TRACE_INSTANT(g_Trace, TraceIRQBackup);    break;
+        case InputSignal::Emergency: TRACE_INSTANT(g_Trace, TraceIRQEmergency); break;
+        case InputSignal::Demo:      TRACE_INSTANT(g_Trace, TraceIRQDemo);      return;
+        default: break;
+    }
+    g_InputRecorder.Record(pin, level);
+}
+
+// Input wiring, in InputSignal order.  There's no brake wire: the brake is
+// inferred from both turn circuits coming on together.  Replays see the
+// GPIO wiring without the demo button, whose edges aren't recorded.
+
+constexpr std::array<uint8_t, InputSignalCount> g_ReplayInputPins = 
+{
+    LEFT_TURN_PIN, RIGHT_TURN_PIN, PIN_NONE, BACKUP_PIN, EMERGENCY_PIN, PIN_NONE,
+};
+
+#if ENABLE_SHIFT_REGISTER_INPUT
+
+constexpr uint8_t NoBit = ShiftRegisterInputSource::NoBit;
+
+constexpr std::array<uint8_t, InputSignalCount> g_GpioInputPins = 
+{
+    PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE, PIN_NONE, DEMO_PIN,
+};
+
+constexpr std::array<uint8_t, InputSignalCount> g_ShiftRegisterInputBits = 
+{
+    0, 1, NoBit, 2, 3, NoBit,
+};
+
+GpioInputSource          g_GpioInput(g_GpioInputPins, OnInputEdge);
+ShiftRegisterInputSource g_ShiftRegisterInput(SR_LOAD_PIN, SR_CLOCK_PIN, SR_DATA_PIN,
+                                              g_ShiftRegisterInputBits);
+LayeredInputSource       g_WiredInput(g_ShiftRegisterInput, g_GpioInput);
+
+#else
+
+constexpr std::array<uint8_t, InputSignalCount> g_GpioInputPins = 
+{
+    LEFT_TURN_PIN, RIGHT_TURN_PIN, PIN_NONE, BACKUP_PIN, EMERGENCY_PIN, DEMO_PIN,
+};
+
+GpioInputSource g_GpioInput(g_GpioInputPins, OnInputEdge);
+InputSource&    g_WiredInput = g_GpioInput;
+
+#endif
+
+#if ENABLE_CAN_INPUT
+// Brake, turns and reverse from the bus; emergency and demo stay wired
+CanInput<g_CanSignals.size()> g_CanInput(g_CanSignals);
+LayeredInputSource            g_CanOverWiredInput(g_CanInput, g_WiredInput);
+#endif
+
+#if ENABLE_CLOCK_SYNC
+// Controllers sharing the sync line on SYNC_PIN run their lighting on one
+// clock.  Build exactly one of them with CLOCK_SYNC_MASTER set; the
+// heltec_wifi_kit_32_V3_clocksync and _clocksync_master environments do.
+#ifndef CLOCK_SYNC_MASTER
+#define CLOCK_SYNC_MASTER 0
+#endif
+
+constexpr ClockSyncRole g_ClockSyncRole = CLOCK_SYNC_MASTER ? ClockSyncRole::Master : ClockSyncRole::Follower;
+
+// A follower only steps its lighting clock after this long with nothing lit
+// and no input, well clear of the debounce and brake detection windows;
+// otherwise it slews
+constexpr uint32_t ClockStepIdleMs = 1000;
+
+ClockSync g_ClockSync(SYNC_PIN);
+bool      g_ClockSyncStarted = false;
+#endif
+
+ReplayInputSource    g_ReplayInput(g_ReplayInputPins);
+SimulatedInputSource g_IdleInput; // Nothing asserted, for renders that must ignore the inputs
+
+// g_LiveInput is the vehicle's inputs, however they're wired.  The render
+// loop polls g_InputSource, which is the live inputs except while a
+// diagnostic has substituted its own (see UseInputSource).  g_Inputs is the
+// render loop's view of them, brought up to date once per frame.
+
+InputSource* g_LiveInput   = &g_WiredInput;
+InputSource* g_InputSource = &g_WiredInput;
+InputUpdate  g_Inputs;
+
+// Demo-mode button (Heltec V3 PRG / GPIO 0). Press once to start a 5-second
+// cycle through every effect; press again to stop. Hold it for StressHoldMs
+// to start an input stress run instead (see ServiceStress). It's the Demo
+// input signal, but not an effect, so the render loop just flags the press
+// here for ServiceDemo() and ServiceStress().
+
+constexpr uint32_t StressHoldMs = 2000;
+
+bool     g_DemoButtonPressed   = false; // Short press, flagged on release
+bool     g_StressButtonPressed = false; // Held past StressHoldMs
+bool     g_DemoMode            = false;
+uint32_t g_DemoPressMs         = 0;
+
+// UIState
+//
+// Snapshot of everything the OLED shows.  The render loop publishes a new one
+// each frame and the UI task draws from it, so the UI never reads pins or
+// effect state itself.  Timing stats are aggregated over a window so that they
+// don't force a redraw every frame.
+
+enum InputBit : uint8_t
+{
+    InputLeft      = 1 << 0,
+    InputRight     = 1 << 1,
+    InputBackup    = 1 << 2,
+    InputEmergency = 1 << 3,
+    InputDemo      = 1 << 4,
+};
+
+struct UIState
+{
+    uint8_t  inputs         = 0; // InputBit mask of asserted inputs
+    uint16_t fps            = 0; // Frames rendered per second over the last window
+    uint32_t frameUsAvg     = 0; // Average processAndDisplayInputs() time over the window
+    uint32_t frameUsMax     = 0; // Worst processAndDisplayInputs() time over the window
+    uint32_t brakeLatencyMs = 0; // Turn-pin edge to brake Begin(), most recent activation
+    uint32_t milliamps      = 0; // Highest estimated strip current over the window
+
+    bool operator==(const UIState& other) const
+    {
+        return inputs == other.inputs && fps == other.fps && frameUsAvg == other.frameUsAvg &&
+               frameUsMax == other.frameUsMax && brakeLatencyMs == other.brakeLatencyMs &&
+               milliamps == other.milliamps;
+    }
+};
+
+constexpr uint32_t UIStatsWindowMs = 500;
+
+UIState      g_UIState;
+portMUX_TYPE g_UIStateMux     = portMUX_INITIALIZER_UNLOCKED;
+uint32_t     g_BrakeLatencyMs = 0;
+
+static uint8_t ReadInputMask()
+{
+    uint8_t mask = 0;
+    if (g_Inputs.IsAsserted(InputSignal::Left))
+        mask |= InputLeft;
+    if (g_Inputs.IsAsserted(InputSignal::Right))
+        mask |= InputRight;
+    if (g_Inputs.IsAsserted(InputSignal::Reverse))
+        mask |= InputBackup;
+    if (g_Inputs.IsAsserted(InputSignal::Emergency))
+        mask |= InputEmergency;
+    return mask;
+}
+
+// PublishUIState
+//
+// Called by the render loop once per frame with how long the frame took and
+// which inputs are asserted.
+
+static void PublishUIState(uint32_t frameUs, uint8_t inputs)
+{
+    static uint32_t windowStartMs = 0;
+    static uint32_t windowFrames  = 0;
+    static uint64_t windowUsTotal = 0;
+    static uint32_t windowUsMax   = 0;
+    static uint32_t windowMaMax   = 0;
+
+    windowFrames++;
+    windowUsTotal += frameUs;
+    windowUsMax    = max(windowUsMax, frameUs);
+    windowMaMax    = max(windowMaMax, g_PowerLimiter.GetEstimateMilliamps());
+
+    const uint32_t now      = millis();
+    const bool     rollover = now - windowStartMs >= UIStatsWindowMs;
+
+    portENTER_CRITICAL(&g_UIStateMux);
+    g_UIState.inputs         = inputs;
+    g_UIState.brakeLatencyMs = g_BrakeLatencyMs;
+    if (rollover)
+    {
+        g_UIState.fps        = windowFrames * 1000 / (now - windowStartMs);
+        g_UIState.frameUsAvg = windowUsTotal / windowFrames;
+        g_UIState.frameUsMax = windowUsMax;
+        g_UIState.milliamps  = windowMaMax;
+    }
+    portEXIT_CRITICAL(&g_UIStateMux);
+
+    if (rollover)
+    {
+        windowStartMs = now;
+        windowFrames  = 0;
+        windowUsTotal = 0;
+        windowUsMax   = 0;
+        windowMaMax   = 0;
+    }
+}
+
+static UIState GetUIState()
+{
+    portENTER_CRITICAL(&g_UIStateMux);
+    const UIState state = g_UIState;
+    portEXIT_CRITICAL(&g_UIStateMux);
+    return state;
+}
+
+// UI
+//
+// Draws the OLED from the published UIState.  Nothing is drawn when the state
+// hasn't changed, and when it has only the text lines that differ are erased
+// and redrawn.  The SSD1306 driver is double-buffered, so display() then only
+// sends the pages that actually changed over I2C.
+
+class UI
+{
+    static constexpr int LineCount  = 3;
+    static constexpr int LineHeight = 16; // Two 8-pixel SSD1306 pages per text line
+    static constexpr int LineLength = 32;
+
+    // Largest values the rows show, so that every row fits in LineLength
+    static constexpr uint32_t MaxShownUs = 99999;
+    static constexpr uint32_t MaxShownMs = 9999;
+    static constexpr uint32_t MaxShownMa = 99999;
+
+    UIState _lastState;
+    char    _drawn[LineCount][LineLength] = {};
+    bool    _hasDrawn                     = false;
+
+public:
+    void DrawIndicators()
+    {
+        const UIState state = GetUIState();
+        if (_hasDrawn && state == _lastState)
+            return;
+        _lastState = state;
+
+        const bool leftPressed      = state.inputs & InputLeft;
+        const bool rightPressed     = state.inputs & InputRight;
+        const bool backupPressed    = state.inputs & InputBackup;
+        const bool emergencyPressed = state.inputs & InputEmergency;
+        const bool brakePressed     = leftPressed && rightPressed;
+
+        char lines[LineCount][LineLength];
+        snprintf(lines[0], LineLength, "L%s B%s R%s Bk%s E%s", leftPressed ? "*" : ".",
+                 brakePressed ? "*" : ".", rightPressed ? "*" : ".", backupPressed ? "*" : ".",
+                 emergencyPressed ? "*" : ".");
+        snprintf(lines[1], LineLength, "FPS %u  %lu/%luus", state.fps,
+                 (unsigned long)min(state.frameUsAvg, MaxShownUs),
+                 (unsigned long)min(state.frameUsMax, MaxShownUs));
+        snprintf(lines[2], LineLength, "Brake lat %lums  %lumA",
+                 (unsigned long)min(state.brakeLatencyMs, MaxShownMs),
+                 (unsigned long)min(state.milliamps, MaxShownMa));
+
+        if (!_hasDrawn)
+            Heltec.display->clear();
+
+        bool dirty = false;
+        for (int i = 0; i < LineCount; i++)
+        {
+            if (_hasDrawn && strcmp(lines[i], _drawn[i]) == 0)
+                continue;
+
+            Heltec.display->setColor(BLACK);
+            Heltec.display->fillRect(0, i * LineHeight, Heltec.display->getWidth(), LineHeight);
+            Heltec.display->setColor(WHITE);
+            Heltec.display->drawString(0, i * LineHeight, lines[i]);
+            strcpy(_drawn[i], lines[i]);
+            dirty = true;
+        }
+        _hasDrawn = true;
+
+        if (dirty)
+            Heltec.display->display();
+    }
+};
+
+UI g_UI;
+
+// -------- Telemetry ---------------------------------------------------------
+//
+// The render loop never prints.  It drops TelemetryRecords into g_Telemetry
+// and telemetryLoop, a low-priority task on core 0, drains them to serial.
+
+TelemetryRing<TelemetryRecord, 256> g_Telemetry;
+uint32_t                            g_FrameCount = 0;
+
+static uint8_t ActiveEffectMask()
+{
+    uint8_t mask = 0;
+    for (size_t i = 0; i < g_AllEffects.size(); i++)
+        if (g_AllEffects[i]->GetActive())
+            mask |= 1 << i;
+    return mask;
+}
+
+// LogTelemetry
+//
+// Render-loop task only (the ring is single-producer).  Never blocks; if the
+// drain task has fallen behind the record is counted as dropped.
+
+static void LogTelemetry(TelemetryKind kind, uint8_t detail, uint32_t value, uint8_t inputs)
+{
+    TelemetryRecord record;
+    record.kind    = static_cast<uint8_t>(kind);
+    record.detail  = detail;
+    record.inputs  = inputs;
+    record.active  = ActiveEffectMask();
+    record.timeMs  = millis();
+    record.frame   = g_FrameCount;
+    record.value   = value;
+    record.irqs[0] = g_InputSource->GetEventCount(InputSignal::Left);
+    record.irqs[1] = g_InputSource->GetEventCount(InputSignal::Right);
+    record.irqs[2] = g_InputSource->GetEventCount(InputSignal::Reverse);
+    record.irqs[3] = g_InputSource->GetEventCount(InputSignal::Emergency);
+    g_Telemetry.Push(record);
+}
+
+static void LogTelemetry(TelemetryKind kind, uint8_t detail = 0, uint32_t value = 0)
+{
+    LogTelemetry(kind, detail, value, ReadInputMask());
+}
+
+// ServiceSerialCommands
+//
+// Single-character commands typed into the serial monitor.  Runs on the
+// telemetry task so that nothing here can hold up a frame.
+//
+//   p   Dump the frame profiler (ENABLE_PROFILER builds)
+//   P   Reset the frame profiler
+//   t   Arm a timeline trace capture; it dumps itself when the buffer fills
+//   T   Stop the trace capture early and dump it (ENABLE_TRACE builds)
+//   e   Export the recorded input edges
+//   r   Replay the recorded input edges as fast as possible
+//   R   Replay the recorded input edges in real time, on the strip
+//   h   Render every effect across a grid of timestamps and print a digest
+//       of each effect's frame hashes
+//   H   Print every frame's hash instead, plus the pixels of every frame that
+//       differs from the one before; bench only
+//   a   Show the ambient light level and run the filter's step test
+//       (ENABLE_AMBIENT_LIGHT builds)
+//   c   Compare brake latency through the CAN decoder against the turn-pin
+//       inference, with simulated presses
+//   s   Start a real-time input stress run on the input pins, optionally
+//       followed by edges/s, minutes and seed ("s 200 60 7"); bench only
+//   S   Stop the stress run early; the report prints when it winds down
+//   v   Run the stress schedule on the virtual clock instead, same arguments
+//   l   Show the lifetime statistics
+//   L   Simulate a year of lifetime statistics saves and report the NVS wear
+//   f   Show frame deadline misses by cause, the worst frame and any stalls
+//   F   Reset the frame deadline statistics
+//   m   Dump heap calls caught on the real-time path since the last check
+//   M   Run every effect through the frame path and report any heap use
+//       (ENABLE_HEAP_GUARD builds)
+//
+// Anything that has to touch the effects is handed to the render loop as a
+// DiagnosticRequest rather than run here.
+
+enum class DiagnosticRequest : uint8_t
+{
+    None = 0,
+    ReplayFast,
+    ReplayRealTime,
+    FrameDigests,
+    FrameHashesAndPixels,
+    HeapCheck,
+    BrakeLatency,
+    StressStart,
+    StressVirtual,
+};
+
+volatile DiagnosticRequest g_DiagnosticRequest = DiagnosticRequest::None;
+
+// Input stress runs (see InputStress.h and the stress section further down)
+
+StressConfig g_StressConfig;
+StressStats  g_StressStats;
+portMUX_TYPE g_StressMux = portMUX_INITIALIZER_UNLOCKED;
+
+std::atomic<bool> g_StressRunning{false};
+std::atomic<bool> g_StressStopRequested{false};
+std::atomic<bool> g_StressReportPending{false}; // Printed by the telemetry task
+
+// PrintStressStats
+//
+// kind says which run it was, real time or virtual.
+
+static void PrintStressStats(const StressStats& stats, const char* kind, const StressConfig& config)
+{
+    const uint32_t seconds = max<uint32_t>(stats.elapsedMs / 1000, 1);
+
+    Serial.printf("Stress (%s), seed %lu, %lu edges/s for %lu s: %lu edges, %lu IRQs (%lu/s), "
+                  "%lu input changes\n",
+                  kind, (unsigned long)config.seed, (unsigned long)config.edgesPerSecond,
+                  (unsigned long)(stats.elapsedMs / 1000), (unsigned long)stats.edges,
+                  (unsigned long)stats.irqs, (unsigned long)(stats.irqs / seconds),
+                  (unsigned long)stats.inputChanges);
+
+    Serial.printf("  Frames %lu, avg %lu us, max %lu us\n", (unsigned long)stats.frames,
+                  (unsigned long)(stats.frames ? stats.frameUsTotal / stats.frames : 0),
+                  (unsigned long)stats.frameUsMax);
+    for (size_t i = 0; i < stats.frameBuckets.size(); i++)
+    {
+        if (i < StressStats::FrameBucketUs.size())
+            Serial.printf("    < %2lu ms %9lu\n",
+                          (unsigned long)(StressStats::FrameBucketUs[i] / 1000),
+                          (unsigned long)stats.frameBuckets[i]);
+        else
+            Serial.printf("    >=%2lu ms %9lu\n",
+                          (unsigned long)(StressStats::FrameBucketUs.back() / 1000),
+                          (unsigned long)stats.frameBuckets[i]);
+    }
+
+    Serial.printf("  Brakes %lu, latency avg %lu ms, max %lu ms\n", (unsigned long)stats.brakes,
+                  (unsigned long)(stats.brakes ? stats.brakeLatencyTotalMs / stats.brakes : 0),
+                  (unsigned long)stats.brakeLatencyMaxMs);
+
+    Serial.printf("  Overruns:");
+    for (size_t i = 0; i < OverrunCauseCount; i++)
+        Serial.printf(" %s %lu", FrameMonitor::CauseName(static_cast<OverrunCause>(i)),
+                      (unsigned long)stats.overruns[i]);
+    Serial.println();
+}
+
+static void PrintStressReport()
+{
+    g_StressReportPending = false;
+
+    portENTER_CRITICAL(&g_StressMux);
+    const StressStats stats = g_StressStats;
+    portEXIT_CRITICAL(&g_StressMux);
+
+    PrintStressStats(stats, "real time", g_StressConfig);
+}
+
+// ReadStressConfig
+//
+// Reads the optional "[edges/s] [minutes] [seed]" that follows a stress
+// command.  Anything left out keeps its last value.
+
+static void ReadStressConfig()
+{
+    Serial.setTimeout(100);
+
+    if (const long rate = Serial.parseInt(); rate > 0)
+        g_StressConfig.edgesPerSecond =
+            std::clamp<long>(rate, StressSchedule::MinEdgesPerSecond, StressSchedule::MaxEdgesPerSecond);
+    if (const long minutes = Serial.parseInt(); minutes > 0)
+        g_StressConfig.durationMs = min<long>(minutes, 24 * 60) * 60000;
+    if (const long seed = Serial.parseInt(); seed > 0)
+        g_StressConfig.seed = seed;
+}
+
+
+#if ENABLE_TRACE
+bool g_TraceDumpPending = false;
+
+static void DumpTrace()
+{
+    g_Trace.Stop();
+    g_Trace.Dump(g_TraceNames);
+    g_TraceDumpPending = false;
+}
+#endif
+
+#if ENABLE_AMBIENT_LIGHT
+static void PrintAmbientLight()
+{
+    Serial.printf("Ambient level %u -> brightness %u\n", g_AmbientLight.GetLevel(),
+                  g_AmbientLight.GetBrightness());
+
+    // Night to day, with increasingly noisy sensors
+    for (uint16_t noise : {0, 100, 400})
+    {
+        const AmbientStepResult result = RunAmbientStepTest(150, 3000, noise);
+        Serial.printf("Step test, noise +/-%u: %u -> %u, 10%% in %lu ms, 90%% in %lu ms, "
+                      "%lu changes while steady\n",
+                      noise, result.startBrightness, result.endBrightness,
+                      (unsigned long)result.rise10Ms, (unsigned long)result.rise90Ms,
+                      (unsigned long)result.steadyChanges);
+    }
+}
+#endif
+
+// StallRecord
+//
+// How many frames have stalled since boot and where the last one was stuck,
+// in RTC memory that keeps its contents through the watchdog reset a stall
+// usually ends in (though not through a power cycle).  The next boot reports
+// it with the reset reason and adds it to the lifetime statistics.  Plain
+// fields only, so that no constructor clears it at boot.
+
+struct StallRecord
+{
+    static constexpr uint32_t Valid = 0x5354414c; // "STAL"
+
+    uint32_t magic;
+    uint32_t count;
+    uint32_t frame;
+    uint32_t phase;
+    uint32_t elapsedUs;
+    uint32_t phaseUs;
+};
+
+RTC_NOINIT_ATTR StallRecord g_StallRecord;
+
+// SendTelemetry
+//
+// Writes one record straight to the serial port.  Telemetry task only, as
+// it is the one that drains the ring.
+
+static void SendTelemetry(const TelemetryRecord& record)
+{
+    char line[TelemetryLineLength + 1];
+    Serial.write(reinterpret_cast<const uint8_t*>(line), EncodeTelemetryLine(record, line));
+}
+
+// CheckForFrameStall
+//
+// Reports a render loop that has been stuck in one frame past FrameStallUs,
+// as text and as a Stall telemetry record, and keeps it in g_StallRecord.
+// The render loop is on the task watchdog, so if it never gets unstuck the
+// watchdog fires a few seconds later; this report, which names the frame
+// phase it's stuck in, will already be on the serial port by then.
+
+static void PrintStall(const StallSnapshot& stall)
+{
+    Serial.printf("Frame %lu stalled in %s: %lu ms into the frame, %lu ms in the phase\n",
+                  (unsigned long)stall.frame, FrameMonitor::PhaseName(stall.phase),
+                  (unsigned long)(stall.elapsedUs / 1000), (unsigned long)(stall.phaseUs / 1000));
+}
+
+static void CheckForFrameStall()
+{
+    StallSnapshot stall;
+    if (!g_FrameMonitor.CheckForStall(stall))
+        return;
+
+    g_StallRecord.count++;
+    g_StallRecord.frame     = stall.frame;
+    g_StallRecord.phase     = static_cast<uint32_t>(stall.phase);
+    g_StallRecord.elapsedUs = stall.elapsedUs;
+    g_StallRecord.phaseUs   = stall.phaseUs;
+
+    TelemetryRecord record = {};
+    record.kind            = static_cast<uint8_t>(TelemetryKind::Stall);
+    record.detail          = static_cast<uint8_t>(stall.phase);
+    record.timeMs          = millis();
+    record.frame           = stall.frame;
+    record.value           = stall.elapsedUs;
+    SendTelemetry(record);
+
+    PrintStall(stall);
+}
+
+static const char* ResetReasonName(esp_reset_reason_t reason)
+{
+    static constexpr const char* names[] = {"unknown", "power on", "external pin", "software",
+                                            "panic", "interrupt watchdog", "task watchdog",
+                                            "other watchdog", "deep sleep", "brownout", "SDIO"};
+    return static_cast<size_t>(reason) < std::size(names) ? names[reason] : "?";
+}
+
+// ReportLastStall
+//
+// Prints why the chip last reset and, if frames stalled before it, the last
+// stall, and counts them in the lifetime statistics.  Then starts
+// g_StallRecord over.  Call once at boot, after g_LifetimeStats.Begin() and
+// before the telemetry task starts checking for stalls.
+
+static void ReportLastStall()
+{
+    const esp_reset_reason_t reason   = esp_reset_reason();
+    const bool               watchdog = reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                                        reason == ESP_RST_WDT;
+
+    Serial.printf("Reset reason: %s\n", ResetReasonName(reason));
+
+    if (g_StallRecord.magic == StallRecord::Valid && g_StallRecord.count)
+    {
+        StallSnapshot stall;
+        stall.frame     = g_StallRecord.frame;
+        stall.phase     = static_cast<FramePhase>(g_StallRecord.phase);
+        stall.elapsedUs = g_StallRecord.elapsedUs;
+        stall.phaseUs   = g_StallRecord.phaseUs;
+
+        Serial.printf("%lu frames stalled before the reset; the last:\n", (unsigned long)g_StallRecord.count);
+        PrintStall(stall);
+        g_LifetimeStats.RecordStalls(g_StallRecord.count, watchdog);
+    }
+
+    g_StallRecord       = {};
+    g_StallRecord.magic = StallRecord::Valid;
+}
+
+// PrintFrameStats
+//
+// Deadline misses by cause, the worst frame's breakdown and any stalls, for
+// the 'f' command.
+
+static void PrintFrameStats()
+{
+    const FrameMonitor::Stats stats = g_FrameMonitor.GetStats();
+
+    Serial.printf("Frames %lu, deadline %lu us, missed:", (unsigned long)stats.frames,
+                  (unsigned long)g_FrameMonitor.GetDeadlineUs());
+    for (size_t i = 0; i < OverrunCauseCount; i++)
+        Serial.printf(" %s %lu", FrameMonitor::CauseName(static_cast<OverrunCause>(i)),
+                      (unsigned long)stats.overruns[i]);
+    Serial.println();
+
+    const FrameTiming& worst = stats.worst;
+    Serial.printf("Worst frame %lu: %lu us (input %lu, render %lu, show %lu)\n",
+                  (unsigned long)worst.frame, (unsigned long)worst.totalUs,
+                  (unsigned long)worst.phaseUs[0], (unsigned long)worst.phaseUs[1],
+                  (unsigned long)worst.phaseUs[2]);
+
+    Serial.printf("Stalls past %lu ms: %lu\n", (unsigned long)(g_FrameMonitor.GetStallUs() / 1000),
+                  (unsigned long)stats.stalls);
+    if (stats.stalls)
+        PrintStall(stats.lastStall);
+}
+
+static void PrintLifetimeStats()
+{
+    g_LifetimeStats.SetInputEvents(g_LiveInput->GetTotalEventCount());
+    g_LifetimeStats.Print(g_EffectNames);
+}
+
+// PrintClockSyncResult
+//
+// One SimulateClockSync run, with the scenario it ran.
+
+static void PrintClockSyncResult(const ClockSyncScenario& scenario, const ClockSyncResult& result)
+{
+    Serial.printf("Clock sync: %u nodes, %lu s, +/-%.0f ppm, %lu us jitter, %lu stray pulses/min, "
+                  "%lu%% busy",
+                  (unsigned)scenario.nodes, (unsigned long)scenario.seconds, scenario.ppm,
+                  (unsigned long)scenario.jitterUs, (unsigned long)scenario.noisePerMinute,
+                  (unsigned long)scenario.busyPercent);
+    if (scenario.restartAtS)
+        Serial.printf(", master restart at %lu s", (unsigned long)scenario.restartAtS);
+    Serial.println();
+
+    if (result.settled)
+        Serial.printf("  Settled in %lu ms, worst %lld us, rms %.1f us, spread %lld us\n",
+                      (unsigned long)result.settledMs, (long long)result.worstUs, result.rmsUs,
+                      (long long)result.spreadUs);
+    else
+        Serial.println("  Never settled");
+
+    Serial.printf("  %lu steps (%lu while lit), %lu backwards, %lu edges rejected\n",
+                  (unsigned long)result.steps, (unsigned long)result.stepsWhileBusy,
+                  (unsigned long)result.backwardSteps, (unsigned long)result.rejectedEdges);
+}
+
+// Followers on a clean line, then with worse crystals and more jitter, then
+// through a master restart with stray pulses on the line and effects often
+// lit
+
+static void RunClockSyncSimulation()
+{
+    ClockSyncScenario rough;
+    rough.ppm      = 100.0f;
+    rough.jitterUs = 200;
+
+    ClockSyncScenario restart;
+    restart.noisePerMinute = 6;
+    restart.restartAtS     = 300;
+    restart.busyPercent    = 50;
+
+    for (const ClockSyncScenario& scenario : { ClockSyncScenario(), rough, restart })
+        PrintClockSyncResult(scenario, SimulateClockSync(scenario));
+}
+
+// A year of flash wear at one sleep a minute and at one every 15 minutes,
+// under the flush policy this build uses
+
+static void SimulateLifetimeWearYear()
+{
+    SimulateLifetimeWear(365, 24 * 60, LIFETIME_IDLE_FLUSH);
+    SimulateLifetimeWear(365, 24 * 4, LIFETIME_IDLE_FLUSH);
+}
+
+static void ServiceSerialCommands()
+{
+    while (Serial.available() > 0)
+    {
+        switch (Serial.read())
+        {
+#if ENABLE_PROFILER
+            case 'p': g_Profiler.Dump(g_ProbeNames); break;
+            case 'P': g_Profiler.Reset(); Serial.println("Profiler reset."); break;
+#endif
+#if ENABLE_TRACE
+            case 't': g_Trace.Start(); g_TraceDumpPending = true; Serial.println("Trace armed."); break;
+            case 'T': DumpTrace(); break;
+#endif
+            case 'e': g_InputRecorder.Export(); break;
+            case 'c': g_DiagnosticRequest = DiagnosticRequest::BrakeLatency; break;
+            case 's': ReadStressConfig(); g_DiagnosticRequest = DiagnosticRequest::StressStart; break;
+            case 'S': g_StressStopRequested = true; break;
+            case 'v': ReadStressConfig(); g_DiagnosticRequest = DiagnosticRequest::StressVirtual; break;
+            case 'l': PrintLifetimeStats(); break;
+            case 'L': SimulateLifetimeWearYear(); break;
+#if ENABLE_CLOCK_SYNC
+            case 'y': g_ClockSync.Print(); break;
+#endif
+            case 'Y': RunClockSyncSimulation(); break;
+            case 'f': PrintFrameStats(); break;
+            case 'F': g_FrameMonitor.Reset(); Serial.println("Frame statistics reset."); break;
+#if ENABLE_AMBIENT_LIGHT
+            case 'a': PrintAmbientLight(); break;
+#endif
+            case 'r': g_DiagnosticRequest = DiagnosticRequest::ReplayFast; break;
+            case 'R': g_DiagnosticRequest = DiagnosticRequest::ReplayRealTime; break;
+            case 'h': g_DiagnosticRequest = DiagnosticRequest::FrameDigests; break;
+            case 'H': g_DiagnosticRequest = DiagnosticRequest::FrameHashesAndPixels; break;
+#if ENABLE_HEAP_GUARD
+            case 'm': g_HeapGuard.Dump(); break;
+            case 'M': g_DiagnosticRequest = DiagnosticRequest::HeapCheck; break;
+#endif
+            default: break;
+        }
+    }
+}
+
+// DrainTelemetry
+//
+// Sends everything in the telemetry ring to the serial port.  If records were
+// dropped, a Dropped record saying how many goes out in their place.
+
+static void DrainTelemetry()
+{
+    TRACE_SCOPE(g_Trace, TraceTelemetry);
+
+    TelemetryRecord record;
+
+    while (g_Telemetry.Pop(record))
+        SendTelemetry(record);
+
+    if (const uint32_t dropped = g_Telemetry.TakeDropped())
+    {
+        record        = {};
+        record.kind   = static_cast<uint8_t>(TelemetryKind::Dropped);
+        record.timeMs = millis();
+        record.value  = dropped;
+        SendTelemetry(record);
+    }
+}
+
+// telemetryLoop
+//
+// Low-priority housekeeping task: drains telemetry, handles serial commands
+// and finishes off trace captures.
+
+void telemetryLoop(void*)
+{
+    for (;;)
+    {
+        DrainTelemetry();
+        CheckForFrameStall();
+        ServiceSerialCommands();
+
+        if (g_StressReportPending)
+            PrintStressReport();
+
+#if ENABLE_TRACE
+        if (g_TraceDumpPending && g_Trace.IsFull())
+            DumpTrace();
+#endif
+        delay(20);
+    }
+}
+
+void DrawBootScreen()
+{
+    Heltec.display->clear();
+    Heltec.display->drawString(0, 0, "ThirdBrakeLight");
+    Heltec.display->drawString(0, 16, "Heltec WiFi Kit 32 V3");
+    Heltec.display->display();
+}
+
+// -------- Boot timeline -----------------------------------------------------
+//
+// setup() only does what's needed to get brake light on the strip: inputs,
+// IRQs and FastLED, plus the serial port so that loop() can log from its
+// first frame.  Everything else (OLED, UI task) comes up later in a
+// low-priority task while loop() is already rendering.  Each stage records
+// micros() since reset so we can see how long power-on-to-brake-ready takes.
+
+enum class BootStage : int
+{
+    SetupEntry = 0,
+    InputsLive,
+    StripReady,
+    SerialUp,
+    FirstFrame,
+    OLEDUp,
+    UITaskUp,
+    Count
+};
+
+uint32_t g_BootTimeline[static_cast<int>(BootStage::Count)] = {};
+
+// Set once the OLED has been initialized; until then nobody may touch
+// Heltec.display.
+
+volatile bool g_DisplayReady = false;
+
+static void MarkBootStage(BootStage stage)
+{
+    g_BootTimeline[static_cast<int>(stage)] = micros();
+}
+
+static const char* BootStageName(int stage)
+{
+    switch (static_cast<BootStage>(stage))
+    {
+        case BootStage::SetupEntry: return "setup() entry";
+        case BootStage::InputsLive: return "Inputs + IRQs live";
+        case BootStage::StripReady: return "Strip ready (brake ready)";
+        case BootStage::SerialUp:   return "Serial up";
+        case BootStage::FirstFrame: return "First frame shown";
+        case BootStage::OLEDUp:     return "OLED up";
+        case BootStage::UITaskUp:   return "UI task started";
+        default:                    return "?";
+    }
+}
+
+static void PrintBootTimeline()
+{
+    Serial.println("Boot timeline (us since reset):");
+    for (int i = 0; i < static_cast<int>(BootStage::Count); i++)
+        Serial.printf("  %-26s %8lu\n", BootStageName(i), (unsigned long)g_BootTimeline[i]);
+}
+
+// displayLoop
+//
+// The display loop is just a thread that sits and draws the display over and
+// over forever.
+
+void displayLoop(void*)
+{
+    for (;;)
+    {
+        {
+            TRACE_SCOPE(g_Trace, TraceUIDraw);
+            g_UI.DrawIndicators();
+        }
+        delay(10);
+    }
+}
+
+// BringUpPeripherals
+//
+// Second half of boot: stored statistics, OLED and the UI task.  Normally runs
+// in bringUpLoop so that the render loop is already live on core 1 while we
+// spend time on the OLED's I2C init.  Serial is already up, so what's printed
+// here may interleave with the render loop's own output, line by line.
+
+static void BringUpPeripherals()
+{
+    Serial.println("Dave's Garage ThirdBrakeLight Startup");
+    Serial.println("-------------------------------------");
+
+    if (!g_LifetimeStats.Begin())
+        Serial.println("No lifetime statistics stored; starting from zero.");
+    ReportLastStall();
+
+    if (xTaskCreateUniversal(telemetryLoop, "telemetryLoop", 3072, nullptr, 1, nullptr, 0) !=
+        pdPASS)
+        Serial.println("Failed to start telemetry task.");
+
+    // The strip's RMT channel was installed by the first ShowStrip() in
+    // setup(), before this task existed, so the OLED's I2C init always comes
+    // after it as the comment there asks.  loop() keeps sending frames over
+    // RMT meanwhile, which doesn't share pins, interrupts or a driver with I2C.
+
+    Serial.println("Starting Heltec V3 OLED...");
+    Heltec.begin(true, false, false);
+
+    // The Heltec library sets a default font internally, but be explicit so we
+    // never end up drawing with a null font pointer if init ordering changes.
+    Heltec.display->setFont(ArialMT_Plain_10);
+    Heltec.display->screenRotate(ANGLE_180_DEGREE);
+    DrawBootScreen();
+    g_DisplayReady = true;
+    MarkBootStage(BootStage::OLEDUp);
+    Serial.println("Heltec V3 OLED initialized.");
+
+#if ENABLE_AMBIENT_LIGHT
+    if (!g_AmbientLight.Begin(0))
+        Serial.println("Failed to start ambient light sampling.");
+#endif
+
+    TaskHandle_t uiTask;
+
+    // Bigger stack (SSD1306 framebuffer + I2C overhead) and priority 1 so the
+    // task isn't starved at IDLE priority. Match NightDriverStrip's pattern.
+
+    if (xTaskCreateUniversal(displayLoop, "displayLoop", 4096, nullptr, 1, &uiTask, 0) != pdPASS)
+        Serial.println("Failed to start display task.");
+    else
+        MarkBootStage(BootStage::UITaskUp);
+
+#if ENABLE_CAN_INPUT
+    Serial.println(g_LiveInput == &g_CanOverWiredInput
+                       ? "CAN input listening."
+                       : "CAN input failed to start; brake inferred from turns.");
+#endif
+#if ENABLE_CLOCK_SYNC
+    if (g_ClockSyncStarted)
+        g_ClockSync.Print();
+    else
+        Serial.println("Clock sync failed to start; lighting runs on its own clock.");
+#endif
+
+    PrintBootTimeline();
+}
+
+// bringUpLoop
+//
+// Low-priority one-shot task on core 0 that runs BringUpPeripherals and then
+// goes away, leaving displayLoop behind.
+
+void bringUpLoop(void*)
+{
+    BringUpPeripherals();
+    vTaskDelete(nullptr);
+}
+
+// setup
+//
+// Setup is called one time at chip boot, before loop(), to do... setup.  Like
+// which pins are input or output, setting up interrupts, and other one-time
+// things.  Kept to the minimum needed to light the strip; the rest of boot
+// happens in bringUpLoop.
+
+void setup()
+{
+    MarkBootStage(BootStage::SetupEntry);
+
+    // The first frame applies whatever inputs are already held
+    g_GpioInput.Begin();
+#if ENABLE_SHIFT_REGISTER_INPUT
+    g_ShiftRegisterInput.Begin();
+#endif
+
+#if ENABLE_CAN_INPUT
+    // High priority on core 0, away from the render loop
+    if (g_CanInput.Begin(CAN_TX_PIN, CAN_RX_PIN, 0))
+        g_LiveInput = &g_CanOverWiredInput;
+#endif
+    g_InputSource = g_LiveInput;
+
+#if ENABLE_CLOCK_SYNC
+    g_ClockSyncStarted = g_ClockSync.Begin(g_ClockSyncRole);
+#endif
+
+    MarkBootStage(BootStage::InputsLive);
+
+    // Initialize FastLED here (NOT in the LEDStripGFX global constructor).
+    // Doing this before any strip draw calls ensures the ESP32-S3's RMT / I2C
+    // peripherals are in a known good state when the Heltec OLED is brought up.
+    // FastLED installs the RMT driver on the first show, so the ShowStrip()
+    // below has to stay ahead of starting bringUpLoop.
+    g_Strip.Begin();
+    g_Strip.SetColorCorrection(CRGB(StripColorCorrection));
+
+    g_Strip.setBrightness(255);
+    g_Strip.fillScreen(BLACK16);
+    g_Strip.ShowStrip();
+
+    MarkBootStage(BootStage::StripReady);
+
+    // Serial before the render loop starts, so nothing loop() prints is lost
+    // or written to an uninitialized port.  This doesn't wait on the host.
+    Serial.begin(115200);
+    MarkBootStage(BootStage::SerialUp);
+
+    // Put the render loop on the task watchdog.  The Arduino core feeds it
+    // after every pass through loop(); diagnostics that hold loop() longer
+    // than that feed it once per frame.
+
+    enableLoopWDT();
+
+    // Priority 1, same as the UI task it starts, so it only gets the CPU
+    // that the render loop isn't using.
+
+    if (xTaskCreateUniversal(bringUpLoop, "bringUpLoop", 4096, nullptr, 1, nullptr, 0) != pdPASS)
+        BringUpPeripherals();
+}
+
+// RequestedBrightness
+//
+// Brightness before power limiting: the ambient-light target if there's a
+// sensor, but never below the minimum of any effect that is lit.
+
+static byte RequestedBrightness()
+{
+#if ENABLE_AMBIENT_LIGHT
+    byte brightness = g_AmbientLight.GetBrightness();
+#else
+    byte brightness = g_Brightness;
+#endif
+
+    for (size_t i = 0; i < g_AllEffects.size(); i++)
+        if (g_AllEffects[i]->GetActive())
+            brightness = max(brightness, g_EffectMinBrightness[i]);
+
+    return brightness;
+}
+
+// ApplyInputs
+//
+// Hands this frame's input changes to the effects.  Unless the input source
+// has a brake signal of its own, the brake is inferred from both turn
+// circuits coming on together.
+
+static void ApplyInputs()
+{
+    for (size_t i = 0; i < InputSignalCount; i++)
+        if (g_SignalEffects[i] && (g_Inputs.changed & (1 << i)))
+            g_SignalEffects[i]->Apply(g_Inputs.asserted & (1 << i));
+
+    if (g_InputSource->Provides() & SignalBit(InputSignal::Brake))
+    {
+        if (g_Inputs.HasChanged(InputSignal::Brake) && g_Inputs.IsAsserted(InputSignal::Brake))
+            g_BrakeLatencyMs = LightingMillis() -
+                               g_Inputs.changeMs[static_cast<size_t>(InputSignal::Brake)];
+        return;
+    }
+
+    const bool leftPressed  = g_Inputs.IsAsserted(InputSignal::Left);
+    const bool rightPressed = g_Inputs.IsAsserted(InputSignal::Right);
+
+    if (leftPressed && rightPressed && g_LeftTurn.GetActive() && g_RightTurn.GetActive() &&
+        g_LeftTurn.TimeElapsedTotal() < BrakeDetectionWindow &&
+        g_RightTurn.TimeElapsedTotal() < BrakeDetectionWindow)
+    {
+        g_LeftTurn.SetActive(false);
+        g_RightTurn.SetActive(false);
+        g_Braking.Begin();
+        g_BrakeLatencyMs =
+            LightingMillis() - min(g_Inputs.changeMs[static_cast<size_t>(InputSignal::Left)],
+                                   g_Inputs.changeMs[static_cast<size_t>(InputSignal::Right)]);
+    }
+    else if (g_Braking.GetActive() && !leftPressed && !rightPressed)
+    {
+        g_Braking.End();
+    }
+}
+
+// ServiceDemoButton
+//
+// A press toggles demo mode when the button is let go, unless it was held
+// for StressHoldMs, which starts or stops a stress run the moment the hold
+// time is reached.  A resync of a button that was already held isn't a press.
+
+static void ServiceDemoButton(bool wasHeld)
+{
+    static bool holdHandled = false;
+
+    const bool held = g_Inputs.IsAsserted(InputSignal::Demo);
+    if (held && !wasHeld)
+    {
+        g_DemoPressMs = millis();
+        holdHandled   = false;
+    }
+    else if (held && !holdHandled && millis() - g_DemoPressMs >= StressHoldMs)
+    {
+        holdHandled           = true;
+        g_StressButtonPressed = true;
+    }
+    else if (!held && wasHeld && !holdHandled)
+    {
+        g_DemoButtonPressed = true;
+    }
+}
+
+// processAndDisplayInputs()
+//
+// Main update loop.  Pass show = false to render without sending the frame
+// to the strip (used when replaying input traces as fast as possible).
+
+void processAndDisplayInputs(bool show = true)
+{
+    HEAP_GUARD_SCOPE(g_HeapGuard);
+    PROFILE_SCOPE(g_Profiler, ProbeFrame);
+    TRACE_SCOPE(g_Trace, TraceFrame);
+
+    g_FrameMonitor.BeginFrame(g_FrameCount);
+
+    {
+        PROFILE_SCOPE(g_Profiler, ProbeClear);
+        g_Strip.fillScreen(BLACK16);
+    }
+
+    {
+        PROFILE_SCOPE(g_Profiler, ProbeInput);
+        TRACE_SCOPE(g_Trace, TraceInput);
+
+        const bool demoWasHeld = g_Inputs.IsAsserted(InputSignal::Demo);
+
+        g_Inputs.changed = 0;
+        g_InputSource->Poll(g_Inputs);
+
+        ServiceDemoButton(demoWasHeld);
+
+        if (!g_DemoMode)
+            ApplyInputs();
+    }
+
+    g_FrameMonitor.BeginPhase(FramePhase::Render);
+
+    {
+        TRACE_SCOPE(g_Trace, TraceDraw);
+
+        for (size_t i = 0; i < g_AllEffects.size(); i++)
+        {
+            PROFILE_SCOPE(g_Profiler, ProbeDraw + i);
+            g_AllEffects[i]->Draw();
+        }
+    }
+
+    if (!show)
+    {
+        g_FrameMonitor.EndFrame();
+        return;
+    }
+
+    g_FrameMonitor.BeginPhase(FramePhase::Show);
+
+    {
+        PROFILE_SCOPE(g_Profiler, ProbeBrightness);
+
+        // Brake red is never dimmed below its legal minimum, even over budget
+        const byte minimum = g_Braking.GetActive() ? MinBrakeBrightness : 0;
+        g_Strip.setBrightness(g_PowerLimiter.Limit(g_Strip, RequestedBrightness(), minimum));
+    }
+
+    PROFILE_SCOPE(g_Profiler, ProbeShow);
+    TRACE_SCOPE(g_Trace, TraceShow);
+    g_Strip.ShowStrip();
+
+    g_FrameMonitor.EndFrame();
+}
+
+// -------- Demo mode ---------------------------------------------------------
+//
+// PRG button toggles a self-running demo that cycles through every effect on
+// a fixed interval so you can validate the hardware without wiring anything
+// to the input pins.
+
+constexpr uint32_t DEMO_STEP_MS = 5000;
+
+enum class DemoStep : int
+{
+    Left = 0,
+    Right,
+    Brake,
+    Hazard,
+    Emergency,
+    Backup,
+    Count
+};
+
+uint32_t g_DemoStartMs  = 0;
+int      g_DemoLastStep = -1;
+
+static void StopAllEffects()
+{
+    for (auto* effect : g_AllEffects)
+        effect->SetActive(false);
+}
+
+// UseInputSource
+//
+// Points the render loop at another input source, starting from a clean
+// slate: every effect stopped, and on the next frame whatever the new source
+// has asserted begins again.
+
+static void UseInputSource(InputSource& source)
+{
+    StopAllEffects();
+    g_InputSource = &source;
+    source.Resync();
+}
+
+static void ApplyDemoStep(int step)
+{
+    StopAllEffects();
+    switch (static_cast<DemoStep>(step))
+    {
+        case DemoStep::Left:      g_LeftTurn.Begin();  break;
+        case DemoStep::Right:     g_RightTurn.Begin(); break;
+        case DemoStep::Brake:     g_Braking.Begin();   break;
+        case DemoStep::Hazard:    g_LeftTurn.Begin(); g_RightTurn.Begin(); break;
+        case DemoStep::Emergency: g_Emergency.Begin(); break;
+        case DemoStep::Backup:    g_Backup.Begin();    break;
+        default: break;
+    }
+}
+
+static void ServiceDemo()
+{
+    if (g_DemoButtonPressed)
+    {
+        g_DemoButtonPressed = false;
+        g_DemoMode          = !g_DemoMode;
+        StopAllEffects();
+        if (g_DemoMode)
+        {
+            LogTelemetry(TelemetryKind::DemoMode, 1);
+            g_DemoStartMs  = millis();
+            g_DemoLastStep = -1;
+        }
+        else
+        {
+            // Back to whatever the inputs are holding
+            g_InputSource->Resync();
+            LogTelemetry(TelemetryKind::DemoMode, 0);
+        }
+    }
+
+    if (!g_DemoMode)
+        return;
+
+    const int step = ((millis() - g_DemoStartMs) / DEMO_STEP_MS) %
+                     static_cast<int>(DemoStep::Count);
+    if (step != g_DemoLastStep)
+    {
+        g_DemoLastStep = step;
+        ApplyDemoStep(step);
+        LogTelemetry(TelemetryKind::DemoStep, step);
+    }
+}
+
+static bool AnyEffectActive()
+{
+    for (auto* effect : g_AllEffects)
+        if (effect->GetActive())
+            return true;
+    return false;
+}
+
+// -------- Input replay ------------------------------------------------------
+//
+// Runs a trace back through the GPIO debounce and frame paths on a virtual
+// clock.  Fast replays skip ShowStrip(), so they measure the input and render
+// logic alone.  On the board the trace is g_InputRecorder, which only holds
+// the last 1024 edges; ReplayInputs takes any indexed edge source, so the
+// native tests (test/test_input_replay) replay traces of any length.
+
+constexpr uint32_t ReplayFramePeriodUs = 8000;
+
+struct ReplayResult : InputReplayer::Result
+{
+    uint32_t brakes            = 0; // Brake events that lit
+    uint32_t maxBrakeLatencyMs = 0; // Worst edge-to-lit time among them
+};
+
+template <typename Source> static ReplayResult ReplayInputs(const Source& edges, bool realTime)
+{
+    g_DemoMode = false;
+    UseInputSource(g_ReplayInput);
+
+    ReplayResult result;
+    g_BrakeLatencyMs = 0;
+
+    static_cast<InputReplayer::Result&>(result) = InputReplayer::Run(
+        edges, ReplayFramePeriodUs, realTime,
+        [](uint8_t pin) { g_ReplayInput.OnPinEdge(pin); },
+        [&, wasBraking = false]() mutable
+        {
+            processAndDisplayInputs(realTime);
+            feedLoopWDT();
+
+            if (g_Braking.GetActive() && !wasBraking)
+            {
+                result.brakes++;
+                result.maxBrakeLatencyMs = max(result.maxBrakeLatencyMs, g_BrakeLatencyMs);
+            }
+            wasBraking = g_Braking.GetActive();
+            return AnyEffectActive();
+        });
+
+    // Back to the real inputs
+    UseInputSource(*g_LiveInput);
+    return result;
+}
+
+static void RunInputReplay(bool realTime)
+{
+    const auto result = ReplayInputs(g_InputRecorder, realTime);
+
+    Serial.printf("Replay: %lu edges, %lu frames, %lu ms virtual in %lu ms, %lu brakes, "
+                  "max brake latency %lu ms\n",
+                  (unsigned long)result.edges, (unsigned long)result.frames,
+                  (unsigned long)result.virtualMs, (unsigned long)result.wallMs,
+                  (unsigned long)result.brakes, (unsigned long)result.maxBrakeLatencyMs);
+}
+
+// -------- Brake latency, CAN vs turn-pin inference --------------------------
+//
+// Puts the same series of simulated brake presses through both input paths
+// on the virtual clock and reports how long each takes to light the brake.
+// On the GPIO path a press is both turn-bulb circuits dropping 3 ms apart,
+// which has to clear the debounce and the brake inference; on the CAN path
+// it's a brake frame encoded and fed to a CanInputSource, so it goes through
+// CanDecoder and needs no debounce.  Presses are 1003 ms apart so they land
+// at every point in the frame period.  The TWAI interrupt to receive task
+// hop, a few tens of microseconds, isn't modelled.
+
+constexpr size_t   LatencyTestPresses   = 20;
+constexpr uint32_t LatencyPressPeriodUs = 1003000;
+constexpr uint32_t LatencyPressLengthUs = 400000;
+constexpr uint8_t  SimulatedCanPin      = 63; // Virtual pin whose level is the simulated brake bit
+
+struct BrakeLatencyResult
+{
+    uint32_t brakes  = 0;
+    uint32_t totalMs = 0;
+    uint32_t maxMs   = 0;
+};
+
+// MeasureBrakeLatency
+//
+// Replays edges through the current input source and times each brake from
+// the falling edge on pressPin to the first frame with the brake lit.
+
+template <typename Source, typename DispatchIRQ>
+static BrakeLatencyResult MeasureBrakeLatency(const Source& edges, uint8_t pressPin,
+                                              DispatchIRQ dispatchIRQ)
+{
+    BrakeLatencyResult result;
+    uint32_t           pressMs    = 0;
+    bool               wasBraking = false;
+
+    InputReplayer::Run(
+        edges, ReplayFramePeriodUs, false,
+        [&](uint8_t pin)
+        {
+            if (pin == pressPin && IsInputPressed(pin))
+                pressMs = LightingMillis();
+            dispatchIRQ(pin);
+        },
+        [&]()
+        {
+            processAndDisplayInputs(false);
+            feedLoopWDT();
+
+            const bool braking = g_Braking.GetActive();
+            if (braking && !wasBraking)
+            {
+                const uint32_t latencyMs = LightingMillis() - pressMs;
+                result.brakes++;
+                result.totalMs += latencyMs;
+                result.maxMs    = max(result.maxMs, latencyMs);
+            }
+            wasBraking = braking;
+            return AnyEffectActive();
+        });
+
+    return result;
+}
+
+static void PrintBrakeLatency(const char* path, const BrakeLatencyResult& result)
+{
+    Serial.printf("  %-4s %2lu brakes, avg %3lu ms, max %3lu ms\n", path,
+                  (unsigned long)result.brakes,
+                  (unsigned long)(result.brakes ? result.totalMs / result.brakes : 0),
+                  (unsigned long)result.maxMs);
+}
+
+struct BrakeLatencyComparison
+{
+    BrakeLatencyResult gpio;
+    BrakeLatencyResult can;
+};
+
+// MeasureBrakeLatencies
+//
+// Runs the same presses down both paths and returns both results; leaves the
+// live input source selected again when it's done.
+
+static BrakeLatencyComparison MeasureBrakeLatencies()
+{
+    std::array<InputEdge, LatencyTestPresses * 4> gpioEdges;
+    std::array<InputEdge, LatencyTestPresses * 2> canEdges;
+
+    for (size_t i = 0; i < LatencyTestPresses; i++)
+    {
+        const uint32_t pressUs   = LatencyPressPeriodUs * (i + 1);
+        const uint32_t releaseUs = pressUs + LatencyPressLengthUs;
+
+        gpioEdges[i * 4 + 0] = {pressUs, LEFT_TURN_PIN, LOW};
+        gpioEdges[i * 4 + 1] = {pressUs + 3000, RIGHT_TURN_PIN, LOW};
+        gpioEdges[i * 4 + 2] = {releaseUs, LEFT_TURN_PIN, HIGH};
+        gpioEdges[i * 4 + 3] = {releaseUs + 3000, RIGHT_TURN_PIN, HIGH};
+
+        canEdges[i * 2 + 0] = {pressUs, SimulatedCanPin, LOW};
+        canEdges[i * 2 + 1] = {releaseUs, SimulatedCanPin, HIGH};
+    }
+
+    g_DemoMode = false;
+
+    BrakeLatencyComparison result;
+
+    UseInputSource(g_ReplayInput);
+    result.gpio = MeasureBrakeLatency(gpioEdges, LEFT_TURN_PIN,
+        [](uint8_t pin) { g_ReplayInput.OnPinEdge(pin); });
+
+    CanInputSource<g_CanSignals.size()> canInput(g_CanSignals);
+    UseInputSource(canInput);
+    result.can = MeasureBrakeLatency(canEdges, SimulatedCanPin,
+        [&](uint8_t pin)
+        {
+            const uint8_t brakeBit = IsInputPressed(pin) ? SignalBit(InputSignal::Brake) : 0;
+            canInput.OnFrame(canInput.GetDecoder().Encode(CanBrakeFrameId, brakeBit));
+        });
+
+    // Back to the real inputs
+    UseInputSource(*g_LiveInput);
+    return result;
+}
+
+static void RunBrakeLatencyTest()
+{
+    const BrakeLatencyComparison result = MeasureBrakeLatencies();
+
+    Serial.printf("Brake latency, %u simulated presses:\n", (unsigned)LatencyTestPresses);
+    PrintBrakeLatency("GPIO", result.gpio);
+    PrintBrakeLatency("CAN", result.can);
+}
+
+// -------- Input stress ------------------------------------------------------
+//
+// Runs a StressSchedule (see InputStress.h) through the input paths and
+// collects frame time, IRQ rate, brake latency and overrun statistics.
+//
+// The real-time run is a bench test: a task on the other core drives the
+// schedule onto the input pins themselves, open-drain, so every edge goes
+// through the real GPIO IRQs, debounce and frame loop at full speed, for as
+// long as the schedule lasts.  Disconnect the vehicle wiring first.  The
+// virtual run pushes the same schedule through ReplayInputSource on the
+// virtual clock instead, as fast as the CPU allows; the native
+// test_input_stress suite runs it that way on the host.
+
+constexpr std::array<uint8_t, StressPinCount> g_StressPins =
+{
+    LEFT_TURN_PIN, RIGHT_TURN_PIN, BACKUP_PIN, EMERGENCY_PIN,
+};
+
+constexpr uint32_t StressYieldUs = 100000; // Longest the driver task busy-waits without a break
 
-BrakingEvent   g_Braking(&g_Strip, PIN_NONE);
-BackupEvent    g_Backup(&g_Strip, BACKUP_PIN);
-SignalEvent    g_LeftTurn(&g_Strip, LEFT_TURN_PIN, SignalEvent::Style::LeftTurn);
-SignalEvent    g_RightTurn(&g_Strip, RIGHT_TURN_PIN, SignalEvent::Style::RightTurn);
-PoliceLightBar g_Emergency(&g_Strip, EMERGENCY_PIN);
+// Baselines taken when the real-time run starts
 
-const std::array<LightingEvent*, 5> g_AllEffects = 
-{
-    &g_Emergency, &g_Braking, &g_LeftTurn, &g_RightTurn, &g_Backup,
-};
+uint32_t                                g_StressStartIRQs = 0;
+std::array<uint32_t, OverrunCauseCount> g_StressStartOverruns{};
 
-// The IRQ vectors do not include accomodation for any context or data, so you
-// can't pass a "this" pointer, which means each IRQ we set must go to a function
-// that then dispatches to the object in question.  It works!  IRAM_ATTR so
-// they're always in RAM.
+// WaitUntilUs
+//
+// Sleeps through long gaps and spins through short ones, so edges land
+// within a few us of their schedule.  Spinning never goes on for longer
+// than StressYieldUs without letting the idle task on this core run.
 
-void IRAM_ATTR BrakingIRQ()
-{
-    g_Braking.IRQ();
-}
-void IRAM_ATTR BackupIRQ()
-{
-    g_Backup.IRQ();
-}
-void IRAM_ATTR LeftTurnIRQ()
+static void WaitUntilUs(int64_t dueUs, int64_t& lastYieldUs)
 {
-    g_LeftTurn.IRQ();
+    for (;;)
+    {
+        const int64_t now = esp_timer_get_time();
+        if (now >= dueUs)
+            return;
+
+        if (dueUs - now > 2000 || now - lastYieldUs > StressYieldUs)
+        {
+            vTaskDelay(pdMS_TO_TICKS(max<int64_t>((dueUs - now) / 1000 - 1, 1)));
+            lastYieldUs = esp_timer_get_time();
+        }
+        else
+        {
+            delayMicroseconds(dueUs - now);
+        }
+    }
 }
-void IRAM_ATTR RightTurnIRQ()
+
+static void SetStressPinsDriven(bool driven)
 {
-    g_RightTurn.IRQ();
+    for (auto pin : g_StressPins)
+    {
+        gpio_set_level(static_cast<gpio_num_t>(pin), HIGH);
+        gpio_set_direction(static_cast<gpio_num_t>(pin),
+                           driven ? GPIO_MODE_INPUT_OUTPUT_OD : GPIO_MODE_INPUT);
+    }
 }
-void IRAM_ATTR EmergencyIRQ()
+
+// stressLoop
+//
+// Drives the schedule onto the pins, then finishes off the statistics for
+// the telemetry task to print.
+
+void stressLoop(void*)
 {
-    g_Emergency.IRQ();
-}
+    StressSchedule schedule(g_StressConfig, g_StressPins);
+    InputEdge      edge;
+    uint32_t       edges = 0;
 
-// Demo-mode button (Heltec V3 PRG / GPIO 0). Press once to start a 5-second
-// cycle through every effect; press again to stop. Separate from the
-// LightingEvent machinery since it's not an effect itself.
+    SetStressPinsDriven(true);
 
-volatile bool g_DemoButtonPressed = false;
-bool          g_DemoMode          = false;
+    const int64_t startUs     = esp_timer_get_time();
+    int64_t       lastYieldUs = startUs;
 
-void IRAM_ATTR DemoIRQ()
-{
-    static uint32_t lastMs = 0;
-    uint32_t        now    = millis();
-    if (now - lastMs < 200)
-        return;
-    if (digitalRead(DEMO_PIN) == LOW)
+    while (!g_StressStopRequested && schedule.Next(edge))
     {
-        g_DemoButtonPressed = true;
-        lastMs              = now;
+        WaitUntilUs(startUs + schedule.GetLastTimeUs(), lastYieldUs);
+        gpio_set_level(static_cast<gpio_num_t>(edge.pin), edge.level);
+        edges++;
     }
-}
 
-class UI
-{
-public:
-    void DrawIndicators()
-    {
-        char line[64];
-        char stats[16];
+    SetStressPinsDriven(false);
 
-        const bool leftPressed      = IsInputPressed(LEFT_TURN_PIN);
-        const bool rightPressed     = IsInputPressed(RIGHT_TURN_PIN);
-        const bool backupPressed    = IsInputPressed(BACKUP_PIN);
-        const bool emergencyPressed = IsInputPressed(EMERGENCY_PIN);
-        const bool brakePressed     = leftPressed && rightPressed;
+    const uint32_t            elapsedMs  = (esp_timer_get_time() - startUs) / 1000;
+    const FrameMonitor::Stats frameStats = g_FrameMonitor.GetStats();
 
-        snprintf(line, sizeof(line), "L%s B%s R%s Bk%s E%s", leftPressed ? "*" : ".",
-                 brakePressed ? "*" : ".", rightPressed ? "*" : ".", backupPressed ? "*" : ".",
-                 emergencyPressed ? "*" : ".");
-        snprintf(stats, sizeof(stats), "FPS %d", FastLED.getFPS());
+    portENTER_CRITICAL(&g_StressMux);
+    g_StressStats.edges     = edges;
+    g_StressStats.irqs      = g_LiveInput->GetTotalEventCount() - g_StressStartIRQs;
+    g_StressStats.elapsedMs = elapsedMs;
+    for (size_t i = 0; i < OverrunCauseCount; i++)
+        g_StressStats.overruns[i] = frameStats.overruns[i] - g_StressStartOverruns[i];
+    portEXIT_CRITICAL(&g_StressMux);
 
-        Heltec.display->clear();
-        Heltec.display->drawString(0, 0, line);
-        Heltec.display->drawString(0, 16, stats);
-        Heltec.display->display();
-    }
-};
+    g_StressRunning       = false;
+    g_StressReportPending = true;
+    vTaskDelete(nullptr);
+}
 
-UI g_UI;
+// StartStress
+//
+// Starts a real-time run with g_StressConfig.  Called on the render loop,
+// since it stops the effects.
 
-void DrawBootScreen()
+static void StartStress()
 {
-    Heltec.display->clear();
-    Heltec.display->drawString(0, 0, "ThirdBrakeLight");
-    Heltec.display->drawString(0, 16, "Heltec WiFi Kit 32 V3");
-    Heltec.display->display();
+    if (g_StressRunning)
+        return;
 
-    g_Strip.fillScreen(BLACK16);
-    g_Strip.ShowStrip();
+#if ENABLE_SHIFT_REGISTER_INPUT
+    Serial.println("Real-time stress drives the input GPIOs; use the virtual run with the shift register.");
+#else
+    g_DemoMode = false;
+    StopAllEffects();
+
+    g_StressStats         = StressStats();
+    g_StressStartIRQs     = g_LiveInput->GetTotalEventCount();
+    g_StressStartOverruns = g_FrameMonitor.GetStats().overruns;
+
+    g_StressStopRequested = false;
+    g_StressRunning       = true;
+    if (xTaskCreateUniversal(stressLoop, "stressLoop", 4096, nullptr, 2, nullptr, 0) != pdPASS)
+    {
+        g_StressRunning = false;
+        Serial.println("Couldn't start the stress task.");
+        return;
+    }
+
+    Serial.printf("Stress run started: seed %lu, %lu edges/s, %lu min\n",
+                  (unsigned long)g_StressConfig.seed, (unsigned long)g_StressConfig.edgesPerSecond,
+                  (unsigned long)(g_StressConfig.durationMs / 60000));
+#endif
 }
 
-// displayLoop
+// ServiceStress
 //
-// The display loop is just a thread that sits and draws the display over and
-// over forever.
+// Holding the PRG button starts a real-time run with the current
+// configuration.  Any press while one is going stops it, rather than
+// toggling demo mode in the middle of it.
 
-void displayLoop(void*)
+static void ServiceStress()
 {
-    for (;;)
+    if (g_StressRunning && (g_StressButtonPressed || g_DemoButtonPressed))
     {
-        g_UI.DrawIndicators();
-        delay(10);
+        g_StressButtonPressed = false;
+        g_DemoButtonPressed   = false;
+        g_StressStopRequested = true;
+    }
+    else if (g_StressButtonPressed)
+    {
+        g_StressButtonPressed = false;
+        StartStress();
     }
 }
 
-// setup
+// RecordStressFrame
 //
-// Setup is called one time at chip boot, before loop(), to do... setup.  Like
-// which pins are input or output, setting up interrupts, and other one-time
-// things.
+// Called by the render loop after each frame while a real-time run is going.
 
-void setup()
+static void RecordStressFrame(uint32_t frameUs)
 {
-    Serial.begin(115200);
+    static bool wasBraking = false;
 
-    Serial.println("Dave's Garage ThirdBrakeLight Startup");
-    Serial.println("-------------------------------------");
+    const bool braking = g_Braking.GetActive();
 
-    Serial.println("Configuring Inputs...");
+    portENTER_CRITICAL(&g_StressMux);
+    g_StressStats.RecordFrame(frameUs, g_Inputs.changed);
+    if (braking && !wasBraking)
+        g_StressStats.RecordBrake(g_BrakeLatencyMs);
+    portEXIT_CRITICAL(&g_StressMux);
 
-    // Active-LOW inputs: idle = HIGH (held by internal pull-up), asserted = LOW.
-    pinMode(LEFT_TURN_PIN, INPUT_PULLUP);
-    pinMode(RIGHT_TURN_PIN, INPUT_PULLUP);
-    pinMode(BACKUP_PIN, INPUT_PULLUP);
-    pinMode(EMERGENCY_PIN, INPUT_PULLUP);
-    pinMode(DEMO_PIN, INPUT_PULLUP);
+    wasBraking = braking;
+}
 
-    Serial.println("Attaching Interrupts to Inputs...");
+// StressVirtual
+//
+// The whole schedule through ReplayInputSource and the frame path on the
+// virtual clock, without ShowStrip().  Frame times are how long each
+// processAndDisplayInputs() took on this CPU; wallMs is how long the run
+// took.
 
-    attachInterrupt(digitalPinToInterrupt(LEFT_TURN_PIN), LeftTurnIRQ, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(RIGHT_TURN_PIN), RightTurnIRQ, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(BACKUP_PIN), BackupIRQ, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(EMERGENCY_PIN), EmergencyIRQ, CHANGE);
-    attachInterrupt(digitalPinToInterrupt(DEMO_PIN), DemoIRQ, CHANGE);
+static StressStats StressVirtual(const StressConfig& config, uint32_t& wallMs)
+{
+    g_DemoMode = false;
+    UseInputSource(g_ReplayInput);
 
-    for (auto* effect : g_AllEffects)
-        effect->SyncToInput();
+    StressStats       stats;
+    const StressEdges edges(config, g_StressPins);
 
-    Serial.println("Clearing Strip...");
+    const uint32_t startIRQs     = g_ReplayInput.GetTotalEventCount();
+    const auto     startOverruns = g_FrameMonitor.GetStats().overruns;
 
-    // Initialize FastLED here (NOT in the LEDStripGFX global constructor).
-    // Doing this before any strip draw calls ensures the ESP32-S3's RMT / I2C
-    // peripherals are in a known good state when the Heltec OLED is brought up.
-    g_Strip.Begin();
+    const auto result = InputReplayer::Run(
+        edges, ReplayFramePeriodUs, false,
+        [](uint8_t pin) { g_ReplayInput.OnPinEdge(pin); },
+        [&, wasBraking = false]() mutable
+        {
+            const uint32_t frameStartUs = micros();
+            processAndDisplayInputs(false);
+            stats.RecordFrame(micros() - frameStartUs, g_Inputs.changed);
+            feedLoopWDT();
+
+            if (g_Braking.GetActive() && !wasBraking)
+                stats.RecordBrake(g_BrakeLatencyMs);
+            wasBraking = g_Braking.GetActive();
+            return AnyEffectActive();
+        });
+
+    stats.edges     = result.edges;
+    stats.irqs      = g_ReplayInput.GetTotalEventCount() - startIRQs;
+    stats.elapsedMs = result.virtualMs;
+
+    const auto endOverruns = g_FrameMonitor.GetStats().overruns;
+    for (size_t i = 0; i < OverrunCauseCount; i++)
+        stats.overruns[i] = endOverruns[i] - startOverruns[i];
+
+    // Back to the real inputs
+    UseInputSource(*g_LiveInput);
+
+    wallMs = result.wallMs;
+    return stats;
+}
 
-    g_Strip.setBrightness(255);
-    g_Strip.fillScreen(BLACK16);
-    g_Strip.ShowStrip();
+static void RunStressVirtual()
+{
+    uint32_t          wallMs = 0;
+    const StressStats stats  = StressVirtual(g_StressConfig, wallMs);
 
-    Serial.println("Starting Heltec V3 OLED...");
-    Heltec.begin(true, false, false);
+    PrintStressStats(stats, "virtual", g_StressConfig);
+    Serial.printf("  Ran in %lu ms\n", (unsigned long)wallMs);
+}
 
-    // The Heltec library sets a default font internally, but be explicit so we
-    // never end up drawing with a null font pointer if init ordering changes.
-    Heltec.display->setFont(ArialMT_Plain_10);
-    Heltec.display->screenRotate(ANGLE_180_DEGREE);
-    DrawBootScreen();
-    Serial.println("Heltec V3 OLED initialized.");
+// -------- Frame hash sweep --------------------------------------------------
+//
+// Renders each effect, and the whole demo sequence, on the virtual clock at a
+// fixed grid of timestamps and hashes every frame.  'h' folds each case's
+// frame hashes into one digest and prints "@D <case> <frames> <digest>" once
+// the sweep is done; the native test_frame_sweep suite renders the same
+// sweep on the host and checks the digests against its golden table, so a
+// render-path change that moves any pixel fails there.  'H' is the bench
+// version for finding out which frames moved: it prints "@H <case> <ms>
+// <hash>" for every frame, plus "@P" pixel lines whenever the frame changes,
+// for tools/frame_hash_diff.py to compare.
+//
+// Every case starts with the turn signals in Incandescent mode, whatever
+// g_SignalMode the build has, so that the digests don't depend on it; the Seq
+// cases switch them to Sequential.
+//
+// The sweep owns the render loop and the virtual clock until it's done, so
+// the input IRQs ignore the pins meanwhile (see GpioInputSource) and edges
+// that land during it are lost; switching back to the live inputs resyncs
+// them, so whatever is held at the end is picked up on the next frame.  An
+// 'h' sweep holds the loop for only as long as the frames take to render,
+// while 'H' also waits on the serial port for every line, so it's for the
+// bench only.
+
+struct FrameSweepCase
+{
+    const char* name;
+    void (*begin)(); // Starts the effect(s); nullptr for the demo sequence
+    uint32_t    durationMs;
+    uint32_t    stepMs;
+    void (*then)()  = nullptr; // Optionally called thenMs into the case
+    uint32_t    thenMs = 0;
+};
 
-    TaskHandle_t uiTask;
+constexpr uint32_t FrameSweepStartMs = 1000;
 
-    // Bigger stack (SSD1306 framebuffer + I2C overhead) and priority 1 so the
-    // task isn't starved at IDLE priority. Match NightDriverStrip's pattern.
+static void SetSignalMode(SignalEvent::Mode mode)
+{
+    g_LeftTurn.SetMode(mode);
+    g_RightTurn.SetMode(mode);
+}
 
-    if (xTaskCreateUniversal(displayLoop, "displayLoop", 4096, nullptr, 1, &uiTask, 0) != pdPASS)
-        Serial.println("Failed to start display task.");
+static void BeginSequential(SignalEvent& signal)
+{
+    SetSignalMode(SignalEvent::Mode::Sequential);
+    signal.Begin();
 }
 
-// processAndDisplayInputs()
+const std::array<FrameSweepCase, 12> g_FrameSweepCases = 
+{{
+    {"Backup",          [] { g_Backup.Begin(); },                                  500, 10},
+    {"Braking",         [] { g_Braking.Begin(); },                                1000, 10},
+    {"LeftTurn",        [] { g_LeftTurn.Begin(); },                               2000, 10},
+    {"RightTurn",       [] { g_RightTurn.Begin(); },                              2000, 10},
+    {"Hazard",          [] { g_LeftTurn.Begin(); g_RightTurn.Begin(); },          2000, 10},
+    {"SeqLeftTurn",     [] { BeginSequential(g_LeftTurn); },                      2000, 10},
+    {"SeqRightTurn",    [] { BeginSequential(g_RightTurn); },                     2000, 10},
+    {"SeqHazard",       [] { BeginSequential(g_LeftTurn); g_RightTurn.Begin(); }, 2000, 10},
+    {"HazardOffset",    [] { g_LeftTurn.Begin(); },                               2000, 10,
+                        [] { g_RightTurn.Begin(); }, 300},
+    {"SeqHazardOffset", [] { BeginSequential(g_LeftTurn); },                      2000, 10,
+                        [] { g_RightTurn.Begin(); }, 300},
+    {"Police",          [] { g_Emergency.Begin(); },                              4000, 10},
+    {"Demo",            nullptr, DEMO_STEP_MS * static_cast<int>(DemoStep::Count), 20},
+}};
+
+constexpr size_t FrameSweepCaseCount = std::tuple_size_v<decltype(g_FrameSweepCases)>;
+
+static void DumpFramePixels(const char* name, uint32_t t)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    const CRGB* leds = g_Strip.GetLEDBuffer();
+    char        chunk[32 * 6 + 1];
+    size_t      pos = 0;
+
+    Serial.printf("@P %s %lu ", name, (unsigned long)t);
+    for (size_t i = 0; i < g_Strip.GetLEDCount(); i++)
+    {
+        for (uint8_t channel : {leds[i].r, leds[i].g, leds[i].b})
+        {
+            chunk[pos++] = hex[channel >> 4];
+            chunk[pos++] = hex[channel & 0x0F];
+        }
+        if (pos == sizeof(chunk) - 1)
+        {
+            Serial.write(reinterpret_cast<const uint8_t*>(chunk), pos);
+            pos = 0;
+        }
+    }
+    chunk[pos++] = '\n';
+    Serial.write(reinterpret_cast<const uint8_t*>(chunk), pos);
+}
+
+// ForEachSweepFrame
 //
-// Main update loop
+// Steps through every case in g_FrameSweepCases on the virtual clock with
+// the real inputs ignored, and calls frame(caseIndex, t) to render each
+// timestamp.  Each case starts with every effect stopped.
 
-void processAndDisplayInputs()
+template <typename Frame> static void ForEachSweepFrame(Frame frame)
 {
-    g_Strip.fillScreen(BLACK16);
+    g_DemoMode          = false;
+    g_InputReplayActive = true;
+    UseInputSource(g_IdleInput);
 
-    if (!g_DemoMode)
+    for (size_t caseIndex = 0; caseIndex < FrameSweepCaseCount; caseIndex++)
     {
-        for (auto* effect : g_AllEffects)
-            effect->CheckForButtonPress();
+        const FrameSweepCase& sweepCase = g_FrameSweepCases[caseIndex];
 
-        const bool leftPressed  = IsInputPressed(LEFT_TURN_PIN);
-        const bool rightPressed = IsInputPressed(RIGHT_TURN_PIN);
+        StopAllEffects();
+        SetSignalMode(SignalEvent::Mode::Incandescent);
 
-        if (leftPressed && rightPressed && g_LeftTurn.GetActive() && g_RightTurn.GetActive() &&
-            g_LeftTurn.TimeElapsedTotal() < BrakeDetectionWindow &&
-            g_RightTurn.TimeElapsedTotal() < BrakeDetectionWindow)
-        {
-            g_LeftTurn.SetActive(false);
-            g_RightTurn.SetActive(false);
-            g_Braking.Begin();
-        }
-        else if (g_Braking.GetActive() && !leftPressed && !rightPressed)
+        int lastStep = -1;
+
+        for (uint32_t t = 0; t < sweepCase.durationMs; t += sweepCase.stepMs)
         {
-            g_Braking.End();
+            g_ReplayMs = FrameSweepStartMs + t;
+
+            if (sweepCase.begin)
+            {
+                if (t == 0)
+                    sweepCase.begin();
+                if (sweepCase.then && t == sweepCase.thenMs)
+                    sweepCase.then();
+            }
+            else if (const int step = t / DEMO_STEP_MS; step != lastStep)
+            {
+                ApplyDemoStep(step);
+                lastStep = step;
+            }
+
+            frame(caseIndex, t);
+            feedLoopWDT();
         }
     }
 
+    g_InputReplayActive = false;
+    SetSignalMode(g_SignalMode);
+    UseInputSource(*g_LiveInput);
+}
+
+// RenderSweepFrame
+//
+// Draws the effects into the strip buffer, without the power limiter or the
+// output pass, and returns the frame's hash.
+
+static uint32_t RenderSweepFrame()
+{
+    g_Strip.fillScreen(BLACK16);
     for (auto* effect : g_AllEffects)
         effect->Draw();
-
-    g_Strip.setBrightness(g_Brightness);
-    g_Strip.ShowStrip();
+    return g_Strip.Hash();
 }
 
-// -------- Demo mode ---------------------------------------------------------
+// SweepFrameDigests
 //
-// PRG button toggles a self-running demo that cycles through every effect on
-// a fixed interval so you can validate the hardware without wiring anything
-// to the input pins.
+// Renders the whole sweep and returns, per case, the frame count and the
+// case's frame hashes folded together with FNV-1a.
 
-constexpr uint32_t DEMO_STEP_MS = 5000;
-
-enum class DemoStep : int
+struct FrameSweepDigest
 {
-    Left = 0,
-    Right,
-    Brake,
-    Hazard,
-    Emergency,
-    Backup,
-    Count
+    uint32_t frames = 0;
+    uint32_t digest = 2166136261u;
 };
 
-uint32_t g_DemoStartMs  = 0;
-int      g_DemoLastStep = -1;
-
-static void StopAllEffects()
+static std::array<FrameSweepDigest, FrameSweepCaseCount> SweepFrameDigests()
 {
-    for (auto* effect : g_AllEffects)
-        effect->SetActive(false);
+    std::array<FrameSweepDigest, FrameSweepCaseCount> digests{};
+
+    ForEachSweepFrame([&](size_t caseIndex, uint32_t) {
+        FrameSweepDigest& entry = digests[caseIndex];
+        entry.frames++;
+        entry.digest = (entry.digest ^ RenderSweepFrame()) * 16777619u;
+    });
+    return digests;
 }
 
-static void ApplyDemoStep(int step)
+static void RunFrameSweep(bool perFrame)
 {
-    StopAllEffects();
-    switch (static_cast<DemoStep>(step))
+    if (!perFrame)
     {
-        case DemoStep::Left:      g_LeftTurn.Begin();  break;
-        case DemoStep::Right:     g_RightTurn.Begin(); break;
-        case DemoStep::Brake:     g_Braking.Begin();   break;
-        case DemoStep::Hazard:    g_LeftTurn.Begin(); g_RightTurn.Begin(); break;
-        case DemoStep::Emergency: g_Emergency.Begin(); break;
-        case DemoStep::Backup:    g_Backup.Begin();    break;
-        default: break;
+        const auto digests = SweepFrameDigests();
+        for (size_t i = 0; i < FrameSweepCaseCount; i++)
+            Serial.printf("@D %s %lu %08lx\n", g_FrameSweepCases[i].name,
+                          (unsigned long)digests[i].frames, (unsigned long)digests[i].digest);
+        Serial.println("@D end");
+        return;
     }
+
+    uint32_t lastHash = 0;
+
+    ForEachSweepFrame([&](size_t caseIndex, uint32_t t) {
+        const char*    name = g_FrameSweepCases[caseIndex].name;
+        const uint32_t hash = RenderSweepFrame();
+
+        Serial.printf("@H %s %lu %08lx\n", name, (unsigned long)t, (unsigned long)hash);
+        if (t == 0 || hash != lastHash)
+            DumpFramePixels(name, t);
+        lastHash = hash;
+    });
+
+    Serial.println("@H end");
 }
 
-static const char* DemoStepName(int step)
+#if ENABLE_HEAP_GUARD
+
+// RunHeapCheck
+//
+// Pushes every frame of the sweep through the full processAndDisplayInputs()
+// path, power limiter and ShowStrip() included, and reports any heap calls
+// it made.  "@M end PASS" means the real-time path is allocation-free for
+// every effect.
+
+static void RunHeapCheck()
 {
-    switch (static_cast<DemoStep>(step))
-    {
-        case DemoStep::Left:      return "Left";
-        case DemoStep::Right:     return "Right";
-        case DemoStep::Brake:     return "Brake";
-        case DemoStep::Hazard:    return "Hazard";
-        case DemoStep::Emergency: return "Emergency";
-        case DemoStep::Backup:    return "Backup";
-        default:                  return "?";
-    }
+    g_HeapGuard.Reset();
+    ForEachSweepFrame([](size_t, uint32_t) { processAndDisplayInputs(); });
+    g_HeapGuard.Dump();
 }
 
-static void ServiceDemo()
+#endif
+
+// -------- Lifetime statistics -----------------------------------------------
+//
+// RecordLifetimeStats feeds each frame of loop() into g_LifetimeStats.  Demo
+// and stress runs aren't the vehicle, so their effects and brakes don't
+// count; overruns always do.  On-time is the time since the last frame,
+// restarted after light sleep and diagnostics and capped at
+// LifetimeMaxFrameMs.  FlushLifetimeStats is only called with the strip
+// idle, since the flash write stalls both cores for a few ms.
+
+static uint32_t g_LifetimeFrameMs = 0; // millis() at the last recorded frame
+
+static void RestartLifetimeClock()
 {
-    if (g_DemoButtonPressed)
-    {
-        g_DemoButtonPressed = false;
-        g_DemoMode          = !g_DemoMode;
-        StopAllEffects();
-        if (g_DemoMode)
-        {
-            Serial.println("DEMO mode: ON");
-            g_DemoStartMs  = millis();
-            g_DemoLastStep = -1;
-        }
-        else
-        {
-            Serial.println("DEMO mode: OFF");
-        }
-    }
+    g_LifetimeFrameMs = millis();
+}
 
-    if (!g_DemoMode)
-        return;
+static void RecordLifetimeStats()
+{
+    static bool wasBraking = false;
 
-    const int step = ((millis() - g_DemoStartMs) / DEMO_STEP_MS) %
-                     static_cast<int>(DemoStep::Count);
-    if (step != g_DemoLastStep)
+    const uint32_t now     = millis();
+    const uint32_t frameMs = min(now - g_LifetimeFrameMs, LifetimeMaxFrameMs);
+    const bool     braking = g_Braking.GetActive();
+
+    if (!g_DemoMode && !g_StressRunning)
     {
-        g_DemoLastStep = step;
-        ApplyDemoStep(step);
-        Serial.printf("DEMO step: %s\n", DemoStepName(step));
+        g_LifetimeStats.RecordFrame(ActiveEffectMask(), frameMs);
+        if (braking && !wasBraking)
+            g_LifetimeStats.RecordBrake(g_BrakeLatencyMs);
     }
+
+    if (const OverrunCause cause = g_FrameMonitor.GetLastCause(); cause != OverrunCause::Count)
+        g_LifetimeStats.RecordOverrun(cause);
+
+    g_LifetimeFrameMs = now;
+    wasBraking        = braking;
+}
+
+static void FlushLifetimeStats(uint32_t minIntervalMs)
+{
+    g_LifetimeStats.SetInputEvents(g_LiveInput->GetTotalEventCount());
+    g_LifetimeStats.Flush(millis(), minIntervalMs);
 }
 
 #if ENABLE_SLEEP
 
-// Sum of IRQ counts across all inputs. Changes whenever any pin toggles, so
-// we can detect activity without caring which pin moved.
-static uint32_t TotalIRQCount()
+// Inputs that can wake us from light sleep, in the bit order used by
+// WakeRecord::pinMask (which matches InputBit).
+
+constexpr std::array<uint8_t, 5> g_WakePins = 
 {
-    return g_LeftTurn.GetIRQCount() + g_RightTurn.GetIRQCount() + g_Backup.GetIRQCount() +
-           g_Emergency.GetIRQCount();
-}
+    LEFT_TURN_PIN, RIGHT_TURN_PIN, BACKUP_PIN, EMERGENCY_PIN, DEMO_PIN,
+};
 
-static bool AnyEffectActive()
+// WakeRecord
+//
+// What woke us and how long it took to get light back on the strip.  Written
+// on every wake so that brake latency after an idle period can be tracked.
+
+struct WakeRecord
 {
-    for (auto* effect : g_AllEffects)
-        if (effect->GetActive())
-            return true;
-    return false;
-}
+    uint32_t                 count       = 0;                          // Wakes since boot
+    esp_sleep_wakeup_cause_t cause       = ESP_SLEEP_WAKEUP_UNDEFINED; // Why the SoC woke
+    uint8_t                  pinMask     = 0; // Bit n set if g_WakePins[n] was asserted at wake
+    uint32_t                 wakeUs      = 0; // micros() when esp_light_sleep_start() returned
+    uint32_t                 photonUs    = 0; // Wake to first frame pushed to the strip
+    uint32_t                 maxPhotonUs = 0; // Worst photonUs seen since boot
+};
+
+WakeRecord g_LastWake;
 
 // Enter light sleep until any input goes LOW (asserted). Light sleep on the
 // ESP32-S3 preserves RAM and resumes execution right after this call - wake
 // latency is ~1-3 ms, fast enough that brake response is imperceptible.
+//
+// On the way back out, the strip comes first: the inputs are decoded and a
+// frame is pushed before we spend any time on the OLED (I2C) or serial port.
+
 static void EnterLightSleep()
 {
-    Serial.println("Sleeping...");
-    Serial.flush();
+    LogTelemetry(TelemetryKind::Sleep);
 
     // Blank the strip and OLED so neither draws power while we're idle.
     g_Strip.fillScreen(BLACK16);
     g_Strip.ShowStrip();
-    Heltec.display->displayOff();
+    if (g_DisplayReady)
+        Heltec.display->displayOff();
+
+    // Power may well go away while we sleep
+    FlushLifetimeStats(LifetimeStats<EffectCount>::SleepFlushIntervalMs);
 
     // Wake on any input going LOW (active-LOW assertion). Idle state is HIGH
     // via INPUT_PULLUP, so we should not wake spuriously.
-    gpio_wakeup_enable((gpio_num_t)LEFT_TURN_PIN, GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)RIGHT_TURN_PIN, GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)BACKUP_PIN, GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)EMERGENCY_PIN, GPIO_INTR_LOW_LEVEL);
-    gpio_wakeup_enable((gpio_num_t)DEMO_PIN, GPIO_INTR_LOW_LEVEL);
+    for (auto pin : g_WakePins)
+        gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_LOW_LEVEL);
+#if ENABLE_CAN_INPUT
+    // Any traffic on a quiet bus starts with a dominant (low) bit
+    gpio_wakeup_enable((gpio_num_t)CAN_RX_PIN, GPIO_INTR_LOW_LEVEL);
+#endif
     esp_sleep_enable_gpio_wakeup();
 
+#if ENABLE_AMBIENT_LIGHT
+    g_AmbientLight.Suspend();
+#endif
+
     esp_light_sleep_start();
 
     // ---- woke up here ----
-    Heltec.display->displayOn();
-    Serial.println("Waking...");
+    g_LastWake.wakeUs  = micros();
+    RestartLifetimeClock();
+    g_LastWake.pinMask = 0;
+    for (size_t i = 0; i < g_WakePins.size(); i++)
+        if (IsInputPressed(g_WakePins[i]))
+            g_LastWake.pinMask |= 1 << i;
+
+    // Re-read the inputs so the edge that woke us is reflected in event
+    // state, then render and push the first frame right away.
+    g_InputSource->Resync();
+    processAndDisplayInputs();
 
-    // Re-read live pin levels so any edge that happened while asleep is
-    // reflected in event state on the very next loop iteration.
-    for (auto* effect : g_AllEffects)
-        effect->SyncToInput();
+    g_LastWake.photonUs    = micros() - g_LastWake.wakeUs;
+    g_LastWake.maxPhotonUs = max(g_LastWake.maxPhotonUs, g_LastWake.photonUs);
+    g_LastWake.cause       = esp_sleep_get_wakeup_cause();
+    g_LastWake.count++;
+    g_LifetimeStats.RecordWake();
+
+    // Only now do the slow housekeeping.
+#if ENABLE_AMBIENT_LIGHT
+    g_AmbientLight.Resume();
+#endif
+    if (g_DisplayReady)
+        Heltec.display->displayOn();
+    LogTelemetry(TelemetryKind::Wake, g_LastWake.cause, g_LastWake.photonUs, g_LastWake.pinMask);
 }
 
 #endif // ENABLE_SLEEP
@@ -387,49 +2384,87 @@ static void EnterLightSleep()
 
 void loop()
 {
-    static ulong frame = 0;
+    switch (g_DiagnosticRequest)
+    {
+        case DiagnosticRequest::ReplayFast:           RunInputReplay(false); break;
+        case DiagnosticRequest::ReplayRealTime:       RunInputReplay(true);  break;
+        case DiagnosticRequest::FrameDigests:         RunFrameSweep(false);  break;
+        case DiagnosticRequest::FrameHashesAndPixels: RunFrameSweep(true);   break;
+        case DiagnosticRequest::BrakeLatency:         RunBrakeLatencyTest(); break;
+        case DiagnosticRequest::StressStart:          StartStress();         break;
+        case DiagnosticRequest::StressVirtual:        RunStressVirtual();    break;
+#if ENABLE_HEAP_GUARD
+        case DiagnosticRequest::HeapCheck:            RunHeapCheck();        break;
+#endif
+        default: break;
+    }
+    if (g_DiagnosticRequest != DiagnosticRequest::None)
+    {
+        g_DiagnosticRequest = DiagnosticRequest::None;
+        RestartLifetimeClock();
+    }
 
-    frame++;
+    g_FrameCount++;
+    ServiceStress();
     ServiceDemo();
-    processAndDisplayInputs();
-
-#if ENABLE_SLEEP
-    // Idle detector: sleep only when no IRQ has fired for IDLE_SLEEP_MS AND no
-    // effect is currently running (a held brake produces no edges but must
-    // stay lit, so we can't rely on IRQ activity alone).
-    static uint32_t lastActivityMs = 0;
-    static uint32_t lastIRQTotal   = 0;
-    const uint32_t  now            = millis();
-    const uint32_t  irqTotal       = TotalIRQCount();
 
-    if (irqTotal != lastIRQTotal || AnyEffectActive())
+    const uint32_t frameStartUs = micros();
+    processAndDisplayInputs();
+    const uint32_t frameUs = micros() - frameStartUs;
+    if (g_StressRunning)
+        RecordStressFrame(frameUs);
+    RecordLifetimeStats();
+    const uint8_t  inputs  = ReadInputMask();
+    PublishUIState(frameUs, inputs);
+
+    if (g_FrameCount == 1)
+        MarkBootStage(BootStage::FirstFrame);
+
+    // Idle detector: idle means no input event has arrived AND no effect is
+    // currently running (a held brake produces no edges but must stay lit, so
+    // we can't rely on input activity alone).  The lighting clock may only be
+    // stepped after ClockStepIdleMs of it, and we sleep after IDLE_SLEEP_MS,
+    // saving lifetime statistics on the way down.  Builds with none of those
+    // leave lastActivityMs unread.
+    [[maybe_unused]] static uint32_t lastActivityMs = 0;
+    static uint32_t                  lastEventTotal = 0;
+    const uint32_t                   now            = millis();
+    const uint32_t                   eventTotal     = g_LiveInput->GetTotalEventCount();
+
+    if (eventTotal != lastEventTotal || AnyEffectActive())
     {
-        lastIRQTotal   = irqTotal;
+        lastEventTotal = eventTotal;
         lastActivityMs = now;
     }
-    else if (now - lastActivityMs > IDLE_SLEEP_MS)
+#if LIFETIME_IDLE_FLUSH
+    else if (now - lastActivityMs > LifetimeFlushIdleMs)
     {
-        EnterLightSleep();
-        lastActivityMs = millis();
-        lastIRQTotal   = TotalIRQCount();
+        FlushLifetimeStats(LifetimeStats<EffectCount>::IdleFlushIntervalMs);
     }
 #endif
 
-    // Continuous-but-throttled diagnostics. We don't want to print every single
-    // frame; ~20 lines/sec is plenty to follow.
-    if (frame % DiagnosticFrameInterval == 0)
+#if ENABLE_CLOCK_SYNC
+    g_ClockSync.Service(now - lastActivityMs > ClockStepIdleMs);
+#endif
+
+#if ENABLE_SLEEP
+    if (now - lastActivityMs > IDLE_SLEEP_MS)
     {
-        Serial.printf("f=%lu  L:p=%d irq=%lu act=%d  R:p=%d irq=%lu act=%d  "
-                      "Bk:p=%d irq=%lu act=%d  E:p=%d irq=%lu act=%d  "
-                      "Br:act=%d  fps=%d\n",
-                      (unsigned long)frame, digitalRead(LEFT_TURN_PIN),
-                      (unsigned long)g_LeftTurn.GetIRQCount(), g_LeftTurn.GetActive(),
-                      digitalRead(RIGHT_TURN_PIN), (unsigned long)g_RightTurn.GetIRQCount(),
-                      g_RightTurn.GetActive(), digitalRead(BACKUP_PIN),
-                      (unsigned long)g_Backup.GetIRQCount(), g_Backup.GetActive(),
-                      digitalRead(EMERGENCY_PIN), (unsigned long)g_Emergency.GetIRQCount(),
-                      g_Emergency.GetActive(), g_Braking.GetActive(),
-                      FastLED.getFPS());
+        EnterLightSleep();
+        lastActivityMs = millis();
+        lastEventTotal = g_LiveInput->GetTotalEventCount();
     }
+#endif
+
+    // Continuous-but-throttled diagnostics. We don't want a record for every
+    // single frame; ~20/sec is plenty to follow.
+    if (g_FrameCount % DiagnosticFrameInterval == 0)
+        LogTelemetry(TelemetryKind::Frame, 0, frameUs, inputs);
+
+    // Every missed deadline is logged, with its cause
+    if (const OverrunCause cause = g_FrameMonitor.GetLastCause(); cause != OverrunCause::Count)
+        LogTelemetry(TelemetryKind::Overrun, static_cast<uint8_t>(cause),
+                     g_FrameMonitor.GetLastFrame().totalUs, inputs);
+
     delay(1);
 }
@@ -0,0 +1,41 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Adafruit_GFX.h (host)
+//
+// Description:
+//
+//   The Adafruit_GFX base class, cut down to the pixel and fill calls.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Arduino.h"
+
+class Adafruit_GFX
+{
+protected:
+    int16_t _width;
+    int16_t _height;
+
+public:
+    Adafruit_GFX(int16_t width, int16_t height) : _width(width), _height(height) {}
+    virtual ~Adafruit_GFX() = default;
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+    {
+        for (int16_t i = x; i < x + w; i++)
+            for (int16_t j = y; j < y + h; j++)
+                drawPixel(i, j, color);
+    }
+
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+};
@@ -0,0 +1,165 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Arduino.h (host)
+//
+// Description:
+//
+//   Stand-in for the Arduino core, FreeRTOS and the few IDF calls the
+//   sources use, so the hardware-free code and the frame path build on a
+//   host for the native environment's tests.  Only what the sources
+//   actually call is here.  Time is the host's monotonic clock, pins read
+//   from g_HostPinLevels, Serial writes to stdout, and critical sections and
+//   IRAM placement compile to nothing since the tests are single-threaded.
+//
+//   Everything is header-only so that each test suite is one translation
+//   unit, with no library to build.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+#define LOW            0
+#define HIGH           1
+#define INPUT          0x01
+#define OUTPUT         0x03
+#define INPUT_PULLUP   0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING         0x01
+#define FALLING        0x02
+#define CHANGE         0x03
+
+// As in the ESP32 core, constrain is a macro; abs and round come from the STL
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// Time
+
+inline int64_t esp_timer_get_time()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() + 1;
+}
+
+inline unsigned long millis() { return static_cast<unsigned long>(esp_timer_get_time() / 1000); }
+inline unsigned long micros() { return static_cast<unsigned long>(esp_timer_get_time()); }
+inline void          delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void          delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+// Pins.  Inputs idle HIGH, as they do with INPUT_PULLUP.
+
+inline std::array<int, 64> g_HostPinLevels = [] { std::array<int, 64> levels; levels.fill(HIGH); return levels; }();
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int  digitalRead(uint8_t pin) { return g_HostPinLevels[pin & 63]; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { g_HostPinLevels[pin & 63] = level; }
+inline int  digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void attachInterrupt(uint8_t, void (*)(), int) {}
+inline void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+inline void detachInterrupt(uint8_t) {}
+
+// Serial
+
+struct HostSerial
+{
+    void   begin(unsigned long) {}
+    void   setTimeout(unsigned long) {}
+    void   flush() { fflush(stdout); }
+    int    available() { return 0; }
+    int    read() { return -1; }
+    long   parseInt() { return 0; }
+    size_t print(const char* text) { return fputs(text, stdout) < 0 ? 0 : strlen(text); }
+    size_t println(const char* text = "") { return print(text) + print("\n"); }
+    size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* data, size_t length) { return fwrite(data, 1, length, stdout); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, format);
+        const int length = vprintf(format, args);
+        va_end(args);
+        return length < 0 ? 0 : length;
+    }
+};
+
+inline HostSerial Serial;
+
+// FreeRTOS.  Tests run on one thread, so tasks are never started and
+// critical sections have nothing to exclude.
+
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void*    TaskHandle_t;
+
+struct portMUX_TYPE
+{
+    int owner;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)      ((void)(mux))
+#define portEXIT_CRITICAL(mux)       ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)  ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)   ((void)(mux))
+#define portYIELD_FROM_ISR(...)
+#define pdPASS                       1
+#define pdFAIL                       0
+#define pdTRUE                       1
+#define pdFALSE                      0
+#define portMAX_DELAY                0xFFFFFFFFu
+#define portTICK_PERIOD_MS           1
+#define configMAX_PRIORITIES         25
+#define pdMS_TO_TICKS(ms)            (ms)
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return reinterpret_cast<TaskHandle_t>(1); }
+inline BaseType_t   xPortInIsrContext() { return pdFALSE; }
+inline BaseType_t   xPortGetCoreID() { return 1; }
+inline TickType_t   xTaskGetTickCount() { return millis(); }
+inline TickType_t   xTaskGetTickCountFromISR() { return millis(); }
+inline void         vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline void         vTaskDelete(TaskHandle_t) {}
+inline uint32_t     ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline void         xTaskNotifyGive(TaskHandle_t) {}
+inline void         vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*) {}
+
+inline BaseType_t xTaskCreateUniversal(void (*)(void*), const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*,
+                                       BaseType_t)
+{
+    return pdFAIL;
+}
+
+inline void enableLoopWDT() {}
+inline void feedLoopWDT() {}
+
+// The ESP object, for the profiler
+
+struct HostESP
+{
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getCycleCount() { return static_cast<uint32_t>(esp_timer_get_time() * 240); }
+};
+
+inline HostESP ESP;
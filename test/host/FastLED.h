@@ -0,0 +1,79 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        FastLED.h (host)
+//
+// Description:
+//
+//   FastLED with no strip behind it.  show() only counts frames, and the
+//   buffer, brightness, correction and dither settings are kept so tests can
+//   check them; the accessors marked host only aren't in the real library.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "pixeltypes.h"
+
+#define UncorrectedColor 0xFFFFFF
+#define TypicalLEDStrip  0xFFB0F0
+#define DISABLE_DITHER   0x00
+#define BINARY_DITHER    0x01
+
+enum EOrder
+{
+    RGB = 0012,
+    GRB = 0102,
+};
+
+template <uint8_t DataPin, EOrder Order> class WS2812B
+{
+};
+
+class CLEDController
+{
+    CRGB* _leds  = nullptr;
+    int   _count = 0;
+
+public:
+    CLEDController& setLeds(CRGB* leds, int count)
+    {
+        _leds  = leds;
+        _count = count;
+        return *this;
+    }
+
+    CRGB* leds() { return _leds; }
+    int   size() const { return _count; }
+};
+
+class CFastLED
+{
+    CLEDController _controller;
+    uint8_t        _brightness = 255;
+    CRGB           _correction = CRGB(UncorrectedColor);
+    uint8_t        _dither     = BINARY_DITHER;
+    uint32_t       _shows      = 0;
+
+public:
+    template <template <uint8_t, EOrder> class Chipset, uint8_t DataPin, EOrder Order>
+    CLEDController& addLeds(CRGB* leds, int count)
+    {
+        return _controller.setLeds(leds, count);
+    }
+
+    void setBrightness(uint8_t brightness) { _brightness = brightness; }
+    void setCorrection(const CRGB& correction) { _correction = correction; }
+    void setDither(uint8_t dither) { _dither = dither; }
+    void show() { _shows++; }
+
+    uint8_t         getBrightness() const { return _brightness; }
+    CRGB            getCorrection() const { return _correction; } // Host only
+    uint8_t         getDither() const { return _dither; }         // Host only
+    uint32_t        getShowCount() const { return _shows; }       // Host only
+    CLEDController& controller() { return _controller; }          // Host only
+};
+
+inline CFastLED FastLED;
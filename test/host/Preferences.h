@@ -0,0 +1,63 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        Preferences.h (host)
+//
+// Description:
+//
+//   Preferences over an in-memory map, lost when the test exits.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Arduino.h"
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences
+{
+    static std::map<std::string, std::vector<uint8_t>>& Store()
+    {
+        static std::map<std::string, std::vector<uint8_t>> store;
+        return store;
+    }
+
+    std::string _namespace;
+
+    std::string Key(const char* key) const { return _namespace + "/" + key; }
+
+public:
+    bool begin(const char* name, bool = false)
+    {
+        _namespace = name;
+        return true;
+    }
+
+    void end() {}
+
+    size_t getBytesLength(const char* key)
+    {
+        const auto entry = Store().find(Key(key));
+        return entry == Store().end() ? 0 : entry->second.size();
+    }
+
+    size_t getBytes(const char* key, void* data, size_t length)
+    {
+        const auto entry = Store().find(Key(key));
+        if (entry == Store().end() || entry->second.size() > length)
+            return 0;
+        memcpy(data, entry->second.data(), entry->second.size());
+        return entry->second.size();
+    }
+
+    size_t putBytes(const char* key, const void* data, size_t length)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        Store()[Key(key)].assign(bytes, bytes + length);
+        return length;
+    }
+};
@@ -0,0 +1,106 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        driver/adc.h (host)
+//
+// Description:
+//
+//   The continuous (DMA) ADC driver's types and calls.  Configuring it
+//   succeeds, but there is no sensor behind it, so reads never return data;
+//   tests drive AmbientFilter directly instead.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "../esp_timer.h"
+
+#ifndef ESP_ERR_TIMEOUT
+#define ESP_ERR_TIMEOUT 0x107
+#endif
+
+#define BIT(n)                    (1u << (n))
+#define SOC_ADC_DIGI_RESULT_BYTES 4
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define ADC_MAX_DELAY             0xFFFFFFFFu
+
+typedef enum
+{
+    ADC1_CHANNEL_0 = 0,
+    ADC1_CHANNEL_1,
+    ADC1_CHANNEL_2,
+    ADC1_CHANNEL_3,
+} adc1_channel_t;
+
+typedef enum
+{
+    ADC_ATTEN_DB_0  = 0,
+    ADC_ATTEN_DB_11 = 3,
+} adc_atten_t;
+
+typedef enum
+{
+    ADC_CONV_SINGLE_UNIT_1 = 1,
+} adc_digi_convert_mode_t;
+
+typedef enum
+{
+    ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+} adc_digi_output_format_t;
+
+typedef struct
+{
+    uint32_t max_store_buf_size;
+    uint32_t conv_num_each_intr;
+    uint32_t adc1_chan_mask;
+    uint32_t adc2_chan_mask;
+} adc_digi_init_config_t;
+
+typedef struct
+{
+    uint8_t atten;
+    uint8_t channel;
+    uint8_t unit;
+    uint8_t bit_width;
+} adc_digi_pattern_config_t;
+
+typedef struct
+{
+    bool                       conv_limit_en;
+    uint32_t                   conv_limit_num;
+    uint32_t                   pattern_num;
+    adc_digi_pattern_config_t* adc_pattern;
+    uint32_t                   sample_freq_hz;
+    adc_digi_convert_mode_t    conv_mode;
+    adc_digi_output_format_t   format;
+} adc_digi_configuration_t;
+
+typedef struct
+{
+    union
+    {
+        struct
+        {
+            uint32_t data : 12;
+            uint32_t reserved12 : 1;
+            uint32_t channel : 4;
+            uint32_t unit : 1;
+            uint32_t reserved17_31 : 14;
+        } type2;
+        uint32_t val;
+    };
+} adc_digi_output_data_t;
+
+inline esp_err_t adc_digi_initialize(const adc_digi_init_config_t*) { return ESP_OK; }
+inline esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t*) { return ESP_OK; }
+inline esp_err_t adc_digi_start() { return ESP_OK; }
+inline esp_err_t adc_digi_stop() { return ESP_OK; }
+
+inline esp_err_t adc_digi_read_bytes(uint8_t*, uint32_t, uint32_t* length, uint32_t)
+{
+    *length = 0;
+    return ESP_ERR_TIMEOUT;
+}
@@ -0,0 +1,40 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        driver/gpio.h (host)
+//
+// Description:
+//
+//   GPIO driver calls on top of the host Arduino.h pin levels.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "../esp_timer.h"
+
+typedef int gpio_num_t;
+
+enum
+{
+    GPIO_INTR_LOW_LEVEL  = 4,
+    GPIO_INTR_HIGH_LEVEL = 5,
+};
+
+enum
+{
+    GPIO_MODE_INPUT           = 1,
+    GPIO_MODE_INPUT_OUTPUT_OD = 7,
+};
+
+inline esp_err_t gpio_wakeup_enable(gpio_num_t, int) { return ESP_OK; }
+inline esp_err_t gpio_set_direction(gpio_num_t, int) { return ESP_OK; }
+inline int       gpio_get_level(gpio_num_t pin) { return digitalRead(pin); }
+
+inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    digitalWrite(pin, level);
+    return ESP_OK;
+}
@@ -0,0 +1,26 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        esp_sleep.h (host)
+//
+// Description:
+//
+//   Light sleep returns at once on the host.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "esp_timer.h"
+
+typedef enum
+{
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_GPIO      = 7,
+} esp_sleep_wakeup_cause_t;
+
+inline esp_err_t                esp_sleep_enable_gpio_wakeup() { return ESP_OK; }
+inline esp_err_t                esp_light_sleep_start() { return ESP_OK; }
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_GPIO; }
@@ -0,0 +1,35 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        esp_system.h (host)
+//
+// Description:
+//
+//   The reset reason, which a test can set in g_HostResetReason to look like
+//   the boot after a watchdog reset.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+
+typedef enum
+{
+    ESP_RST_UNKNOWN = 0,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t g_HostResetReason = ESP_RST_POWERON;
+
+inline esp_reset_reason_t esp_reset_reason() { return g_HostResetReason; }
@@ -0,0 +1,48 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        esp_timer.h (host)
+//
+// Description:
+//
+//   esp_timer_get_time() is in the host Arduino.h; timers never fire on the
+//   host, so creating one just reports success.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Arduino.h"
+
+typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+typedef struct esp_timer* esp_timer_handle_t;
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    void (*callback)(void* arg);
+    void*                arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char*          name;
+    bool                 skip_unhandled_events;
+} esp_timer_create_args_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t*, esp_timer_handle_t* timer)
+{
+    *timer = nullptr;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t, uint64_t) { return ESP_OK; }
@@ -0,0 +1,54 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        heltec.h (host)
+//
+// Description:
+//
+//   The Heltec board object with an OLED that draws nothing.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Arduino.h"
+
+#define ArialMT_Plain_10 nullptr
+
+enum DISPLAY_ANGLE
+{
+    ANGLE_0_DEGREE = 0,
+    ANGLE_180_DEGREE = 2,
+};
+
+enum OLEDDISPLAY_COLOR
+{
+    BLACK = 0,
+    WHITE = 1,
+};
+
+struct SSD1306Wire
+{
+    void clear() {}
+    void display() {}
+    void displayOn() {}
+    void displayOff() {}
+    void setFont(const uint8_t*) {}
+    void setColor(OLEDDISPLAY_COLOR) {}
+    void screenRotate(DISPLAY_ANGLE) {}
+    void drawString(int16_t, int16_t, const char*) {}
+    void fillRect(int16_t, int16_t, int16_t, int16_t) {}
+    int  getWidth() const { return 128; }
+};
+
+struct HeltecClass
+{
+    SSD1306Wire  oled;
+    SSD1306Wire* display = &oled;
+
+    void begin(bool, bool, bool) {}
+};
+
+inline HeltecClass Heltec;
@@ -0,0 +1,50 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        pixeltypes.h (host)
+//
+// Description:
+//
+//   The part of FastLED's CRGB that the sources use, laid out the same way.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include "Arduino.h"
+
+struct CRGB
+{
+    union
+    {
+        struct
+        {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+        };
+        uint8_t raw[3];
+    };
+
+    enum HTMLColorCode : uint32_t
+    {
+        Black = 0x000000,
+        Blue  = 0x0000FF,
+        Red   = 0xFF0000,
+        White = 0xFFFFFF,
+    };
+
+    constexpr CRGB() : r(0), g(0), b(0) {}
+    constexpr CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    constexpr CRGB(uint32_t code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+    constexpr CRGB(HTMLColorCode code) : CRGB(static_cast<uint32_t>(code)) {}
+
+    constexpr bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+    constexpr bool operator!=(const CRGB& other) const { return !(*this == other); }
+};
+
+// A 16-entry palette as FastLED keeps it in flash: 0xRRGGBB values
+
+typedef uint32_t TProgmemRGBPalette16[16];
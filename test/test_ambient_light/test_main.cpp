@@ -0,0 +1,72 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_ambient_light)
+//
+// Description:
+//
+//   Drives the ambient light filter from the simulated sensor in
+//   RunAmbientStepTest, as the board's 'a' command does, and checks the
+//   brightness curve, how quickly a step in the light is followed and that
+//   a noisy but steady sensor never moves the brightness.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#define ENABLE_AMBIENT_LIGHT 1
+#include "main.cpp"
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_curve_is_monotonic_and_clamped()
+{
+    TEST_ASSERT_EQUAL(AmbientFilter::Curve.front().brightness, AmbientFilter::BrightnessForLevel(0));
+    TEST_ASSERT_EQUAL(AmbientFilter::Curve.back().brightness, AmbientFilter::BrightnessForLevel(4095));
+
+    uint8_t previous = 0;
+    for (uint16_t level = 0; level <= 4095; level++)
+    {
+        const uint8_t brightness = AmbientFilter::BrightnessForLevel(level);
+        TEST_ASSERT_GREATER_OR_EQUAL(previous, brightness);
+        previous = brightness;
+    }
+}
+
+void test_step_to_daylight_is_followed_within_a_second()
+{
+    for (uint16_t noise : {0, 100, 400})
+    {
+        for (uint32_t seed : {1u, 7u, 1234u})
+        {
+            const AmbientStepResult result = RunAmbientStepTest(150, 3000, noise, seed);
+
+            TEST_ASSERT_INT_WITHIN(6, AmbientFilter::BrightnessForLevel(150), result.startBrightness);
+            TEST_ASSERT_INT_WITHIN(6, AmbientFilter::BrightnessForLevel(3000), result.endBrightness);
+            TEST_ASSERT_GREATER_THAN(0, result.rise10Ms);
+            TEST_ASSERT_LESS_OR_EQUAL(1000, result.rise90Ms);
+            TEST_ASSERT_EQUAL(0, result.steadyChanges);
+        }
+    }
+}
+
+void test_step_to_darkness_is_followed_within_two_seconds()
+{
+    const AmbientStepResult result = RunAmbientStepTest(3000, 150, 100);
+
+    TEST_ASSERT_INT_WITHIN(6, AmbientFilter::BrightnessForLevel(150), result.endBrightness);
+    TEST_ASSERT_LESS_OR_EQUAL(2000, result.rise90Ms);
+    TEST_ASSERT_EQUAL(0, result.steadyChanges);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_curve_is_monotonic_and_clamped);
+    RUN_TEST(test_step_to_daylight_is_followed_within_a_second);
+    RUN_TEST(test_step_to_darkness_is_followed_within_two_seconds);
+    return UNITY_END();
+}
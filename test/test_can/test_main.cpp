@@ -0,0 +1,157 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_can)
+//
+// Description:
+//
+//   Checks the CAN signal path that doesn't need the TWAI controller:
+//   CanDecoder encoding and decoding the example signal map, the single
+//   acceptance filter it builds for that map, and the brake latency test
+//   behind the c command, which should show a CAN brake frame lighting the
+//   brake sooner than the inference from the turn-bulb circuits.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+#include <vector>
+
+struct SignalChange
+{
+    InputSignal signal;
+    bool        asserted;
+};
+
+static std::vector<SignalChange> DecodeChanges(CanDecoder<g_CanSignals.size()>& decoder,
+                                               const CanFrame& frame)
+{
+    std::vector<SignalChange> changes;
+    decoder.Decode(frame, [&](InputSignal signal, bool asserted)
+                   { changes.push_back({signal, asserted}); });
+    return changes;
+}
+
+// PassesFilter
+//
+// The controller's single-filter test for a standard data frame: the id sits
+// in the top 11 bits, and every bit not masked must match the code.
+
+static bool PassesFilter(const CanDecoder<g_CanSignals.size()>& decoder, uint16_t id)
+{
+    const uint32_t bits = static_cast<uint32_t>(id) << 21;
+    return ((bits ^ decoder.AcceptanceCode()) & ~decoder.AcceptanceMask()) == 0;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_encoded_frames_decode_to_the_same_signals()
+{
+    CanDecoder<g_CanSignals.size()> encoder(g_CanSignals);
+    CanDecoder<g_CanSignals.size()> decoder(g_CanSignals);
+
+    const uint8_t  lights = SignalBit(InputSignal::Right) | SignalBit(InputSignal::Reverse);
+    const CanFrame frame  = encoder.Encode(CanLightsFrameId, lights);
+
+    TEST_ASSERT_EQUAL_UINT32(CanLightsFrameId, frame.id);
+    TEST_ASSERT_EQUAL_UINT32(3, frame.length);
+    TEST_ASSERT_EQUAL_HEX32(0x02, frame.data[1]);
+    TEST_ASSERT_EQUAL_HEX32(0x10, frame.data[2]);
+
+    const auto changes = DecodeChanges(decoder, frame);
+    TEST_ASSERT_EQUAL(2, changes.size());
+    TEST_ASSERT_EQUAL_HEX32(lights, decoder.GetState());
+
+    // The brake frame carries only the brake
+
+    const CanFrame brake = encoder.Encode(CanBrakeFrameId, 0xFF);
+    TEST_ASSERT_EQUAL_UINT32(1, brake.length);
+    TEST_ASSERT_EQUAL_HEX32(0x01, brake.data[0]);
+    DecodeChanges(decoder, brake);
+    TEST_ASSERT_EQUAL_HEX32(lights | SignalBit(InputSignal::Brake), decoder.GetState());
+}
+
+void test_only_changes_are_reported()
+{
+    CanDecoder<g_CanSignals.size()> decoder(g_CanSignals);
+    const CanFrame on  = decoder.Encode(CanBrakeFrameId, SignalBit(InputSignal::Brake));
+    const CanFrame off = decoder.Encode(CanBrakeFrameId, 0);
+
+    auto changes = DecodeChanges(decoder, on);
+    TEST_ASSERT_EQUAL(1, changes.size());
+    TEST_ASSERT_TRUE(changes[0].signal == InputSignal::Brake);
+    TEST_ASSERT_TRUE(changes[0].asserted);
+
+    // The vehicle repeats its status frames; repeats say nothing new
+
+    for (int i = 0; i < 10; i++)
+        TEST_ASSERT_EQUAL(0, DecodeChanges(decoder, on).size());
+
+    changes = DecodeChanges(decoder, off);
+    TEST_ASSERT_EQUAL(1, changes.size());
+    TEST_ASSERT_FALSE(changes[0].asserted);
+}
+
+void test_unknown_ids_and_short_frames_are_ignored()
+{
+    CanDecoder<g_CanSignals.size()> decoder(g_CanSignals);
+
+    CanFrame other = decoder.Encode(CanBrakeFrameId, SignalBit(InputSignal::Brake));
+    other.id       = 0x123;
+    TEST_ASSERT_EQUAL(0, DecodeChanges(decoder, other).size());
+
+    // Reverse lives in byte 2, so a two-byte lights frame can't carry it
+
+    CanFrame shortFrame = decoder.Encode(CanLightsFrameId, 0xFF);
+    shortFrame.length   = 2;
+    const auto changes  = DecodeChanges(decoder, shortFrame);
+    TEST_ASSERT_EQUAL(2, changes.size());
+    TEST_ASSERT_FALSE(decoder.GetState() & SignalBit(InputSignal::Reverse));
+}
+
+void test_acceptance_filter_passes_every_mapped_id()
+{
+    const CanDecoder<g_CanSignals.size()> decoder(g_CanSignals);
+
+    for (const auto& entry : g_CanSignals)
+        TEST_ASSERT_TRUE(PassesFilter(decoder, entry.id));
+
+    // 0x0A0 and 0x0A8 differ only in bit 3, so that's the one id bit left
+    // as a don't care; RTR and the data bytes are never compared
+
+    TEST_ASSERT_EQUAL_HEX32(0x0A0u << 21, decoder.AcceptanceCode());
+    TEST_ASSERT_EQUAL_HEX32((0x008u << 21) | 0x001FFFFF, decoder.AcceptanceMask());
+    TEST_ASSERT_FALSE(PassesFilter(decoder, 0x123));
+    TEST_ASSERT_FALSE(PassesFilter(decoder, 0x0A1));
+    TEST_ASSERT_FALSE(PassesFilter(decoder, 0x2A0));
+}
+
+void test_can_brake_beats_the_turn_pin_inference()
+{
+    const BrakeLatencyComparison result = MeasureBrakeLatencies();
+
+    TEST_ASSERT_EQUAL_UINT32(LatencyTestPresses, result.gpio.brakes);
+    TEST_ASSERT_EQUAL_UINT32(LatencyTestPresses, result.can.brakes);
+    TEST_ASSERT_LESS_THAN(result.gpio.maxMs, result.can.maxMs);
+    TEST_ASSERT_LESS_THAN(result.gpio.totalMs, result.can.totalMs);
+
+    // The CAN path has no debounce to clear, so a brake is lit within a frame
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(ReplayFramePeriodUs / 1000 + 1, result.can.maxMs);
+    TEST_ASSERT_TRUE(g_InputSource == g_LiveInput);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_encoded_frames_decode_to_the_same_signals);
+    RUN_TEST(test_only_changes_are_reported);
+    RUN_TEST(test_unknown_ids_and_short_frames_are_ignored);
+    RUN_TEST(test_acceptance_filter_passes_every_mapped_id);
+    RUN_TEST(test_can_brake_beats_the_turn_pin_inference);
+    return UNITY_END();
+}
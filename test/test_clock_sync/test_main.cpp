@@ -0,0 +1,138 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_clock_sync)
+//
+// Description:
+//
+//   ClockDiscipline on the host: a stray pulse doesn't move the clock, a
+//   master on a new phase is only followed after LockEdges agree, and the
+//   clock then steps forward if allowed and slews if not, never back.  The
+//   simulation checks the same over ten minutes of followers, including a
+//   master restart with stray pulses and effects lit.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+
+constexpr int64_t PeriodUs = SyncPeriodUs;
+
+void setUp() {}
+void tearDown() {}
+
+// Locks a discipline onto edges at whole periods of its own clock, so that
+// lighting time and local time agree
+
+static void Lock(ClockDiscipline& discipline)
+{
+    for (uint32_t i = 1; i <= ClockDiscipline::LockEdges; i++)
+        discipline.Observe(i * PeriodUs, true);
+    TEST_ASSERT_TRUE(discipline.IsLocked(ClockDiscipline::LockEdges * PeriodUs));
+}
+
+void test_a_stray_pulse_is_ignored()
+{
+    ClockDiscipline discipline;
+    Lock(discipline);
+
+    const int64_t strayUs = ClockDiscipline::LockEdges * PeriodUs + PeriodUs / 3;
+    const int64_t before  = discipline.ToSynced(strayUs);
+    TEST_ASSERT_FALSE(discipline.Observe(strayUs, true));
+    TEST_ASSERT_EQUAL(before, discipline.ToSynced(strayUs));
+
+    // The next real edge is still on the grid
+    const int64_t edgeUs = (ClockDiscipline::LockEdges + 1) * PeriodUs;
+    discipline.Observe(edgeUs, true);
+    TEST_ASSERT_EQUAL(0, discipline.GetLastErrorUs());
+    TEST_ASSERT_EQUAL(0, discipline.GetStepCount());
+}
+
+// The master comes back 100 ms later in the period than before
+
+void test_a_new_phase_is_stepped_forward_when_idle()
+{
+    ClockDiscipline discipline;
+    Lock(discipline);
+
+    int64_t edgeUs = (ClockDiscipline::LockEdges + 5) * PeriodUs + 100000;
+    for (uint32_t i = 1; i < ClockDiscipline::LockEdges; i++, edgeUs += PeriodUs)
+    {
+        const int64_t before = discipline.ToSynced(edgeUs);
+        TEST_ASSERT_FALSE(discipline.Observe(edgeUs, true));
+        TEST_ASSERT_EQUAL(before, discipline.ToSynced(edgeUs));
+    }
+
+    const int64_t before = discipline.ToSynced(edgeUs);
+    TEST_ASSERT_TRUE(discipline.Observe(edgeUs, true));
+    TEST_ASSERT_EQUAL(before + PeriodUs - 100000, discipline.ToSynced(edgeUs));
+}
+
+void test_a_new_phase_is_slewed_while_lit()
+{
+    ClockDiscipline discipline;
+    Lock(discipline);
+
+    int64_t edgeUs  = (ClockDiscipline::LockEdges + 5) * PeriodUs + 100000;
+    int64_t lastUs  = discipline.ToSynced(edgeUs);
+    int64_t errorUs = 0;
+    for (uint32_t i = 0; i < 40; i++, edgeUs += PeriodUs)
+    {
+        TEST_ASSERT_FALSE(discipline.Observe(edgeUs, false));
+
+        // Never backwards, and never more than MaxSlewQ32 off the right rate
+        for (int64_t us = edgeUs; us < edgeUs + PeriodUs; us += PeriodUs / 8)
+        {
+            const int64_t syncedUs = discipline.ToSynced(us);
+            TEST_ASSERT_GREATER_OR_EQUAL(lastUs, syncedUs);
+            lastUs = syncedUs;
+        }
+        errorUs = discipline.GetLastErrorUs();
+    }
+
+    TEST_ASSERT_EQUAL(0, discipline.GetStepCount());
+    TEST_ASSERT_INT_WITHIN(ClockDiscipline::GateUs, 0, errorUs);
+}
+
+void test_followers_settle_on_a_clean_line()
+{
+    const ClockSyncResult result = SimulateClockSync(ClockSyncScenario());
+
+    TEST_ASSERT_TRUE(result.settled);
+    TEST_ASSERT_LESS_THAN(2000, result.settledMs);
+    TEST_ASSERT_LESS_THAN(100, result.worstUs);
+    TEST_ASSERT_EQUAL(0, result.backwardSteps);
+}
+
+void test_followers_ride_out_a_master_restart()
+{
+    for (uint32_t seed = 1; seed <= 10; seed++)
+    {
+        ClockSyncScenario scenario;
+        scenario.noisePerMinute = 30;
+        scenario.restartAtS     = 300;
+        scenario.busyPercent    = 50;
+        scenario.seed           = seed;
+
+        const ClockSyncResult result = SimulateClockSync(scenario);
+
+        TEST_ASSERT_TRUE(result.settled);
+        TEST_ASSERT_LESS_THAN(10000, result.settledMs);
+        TEST_ASSERT_EQUAL(0, result.backwardSteps);
+        TEST_ASSERT_EQUAL(0, result.stepsWhileBusy);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_a_stray_pulse_is_ignored);
+    RUN_TEST(test_a_new_phase_is_stepped_forward_when_idle);
+    RUN_TEST(test_a_new_phase_is_slewed_while_lit);
+    RUN_TEST(test_followers_settle_on_a_clean_line);
+    RUN_TEST(test_followers_ride_out_a_master_restart);
+    return UNITY_END();
+}
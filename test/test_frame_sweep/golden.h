@@ -0,0 +1,41 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        golden.h (test_frame_sweep)
+//
+// Description:
+//
+//   Expected frame sweep digests, in g_FrameSweepCases order: the case, its
+//   frame count and the FNV-1a fold of its frame hashes.  The same values
+//   the board prints for 'h'.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#pragma once
+#include <cstdint>
+
+struct GoldenDigest
+{
+    const char* name;
+    uint32_t    frames;
+    uint32_t    digest;
+};
+
+inline constexpr GoldenDigest g_GoldenDigests[] =
+{
+    {"Backup",            50, 0x3bb439b2},
+    {"Braking",          100, 0x044f4111},
+    {"LeftTurn",         200, 0x2c4cb675},
+    {"RightTurn",        200, 0xd7fc12fd},
+    {"Hazard",           200, 0x4960a0fd},
+    {"SeqLeftTurn",      200, 0xf9049d7d},
+    {"SeqRightTurn",     200, 0x0dd2389d},
+    {"SeqHazard",        200, 0xf4f905fd},
+    {"HazardOffset",     200, 0x22a8e8da},
+    {"SeqHazardOffset",  200, 0xd8340119},
+    {"Police",           400, 0x7edaba75},
+    {"Demo",            1500, 0xc3cb126d},
+};
@@ -0,0 +1,61 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_frame_sweep)
+//
+// Description:
+//
+//   Renders the frame hash sweep (see RunFrameSweep in main.cpp) and checks
+//   each case's digest against golden.h.  A change that is meant to alter
+//   the output updates golden.h in the same commit: on a mismatch the test
+//   prints the whole table in golden.h's form, ready to paste in, and the
+//   board's 'H' command with tools/frame_hash_diff.py shows which frames and
+//   pixels moved.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include "golden.h"
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_sweep_matches_golden_digests()
+{
+    const auto digests = SweepFrameDigests();
+
+    bool matches = std::size(g_GoldenDigests) == FrameSweepCaseCount;
+    for (size_t i = 0; matches && i < FrameSweepCaseCount; i++)
+        matches = strcmp(g_GoldenDigests[i].name, g_FrameSweepCases[i].name) == 0 &&
+                  g_GoldenDigests[i].frames == digests[i].frames &&
+                  g_GoldenDigests[i].digest == digests[i].digest;
+
+    if (!matches)
+        for (size_t i = 0; i < FrameSweepCaseCount; i++)
+            printf("    {\"%s\", %lu, 0x%08lx},\n", g_FrameSweepCases[i].name,
+                   (unsigned long)digests[i].frames, (unsigned long)digests[i].digest);
+
+    TEST_ASSERT_TRUE_MESSAGE(matches, "Frame sweep digests differ from golden.h");
+}
+
+void test_sweep_is_repeatable()
+{
+    const auto first  = SweepFrameDigests();
+    const auto second = SweepFrameDigests();
+
+    for (size_t i = 0; i < FrameSweepCaseCount; i++)
+        TEST_ASSERT_EQUAL_HEX32_MESSAGE(first[i].digest, second[i].digest, g_FrameSweepCases[i].name);
+    TEST_ASSERT_FALSE(g_InputReplayActive);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep_matches_golden_digests);
+    RUN_TEST(test_sweep_is_repeatable);
+    return UNITY_END();
+}
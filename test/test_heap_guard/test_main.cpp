@@ -0,0 +1,141 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_heap_guard)
+//
+// Description:
+//
+//   The heap guard build on the host: every frame of the sweep, and a
+//   replayed run of brake and turn inputs, go through the full
+//   processAndDisplayInputs() path and the test fails if any of it touched
+//   the heap.
+//
+//   The board gets its allocator calls into HeapGuard with -Wl,--wrap.  On
+//   the host the same __wrap_ functions are reached by defining the
+//   allocator itself in the test: with glibc the malloc family is replaced
+//   for the whole process, so operator new and anything else in libstdc++
+//   are caught too, and elsewhere the global operator new and delete are
+//   replaced, which catches the C++ allocations.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#define ENABLE_HEAP_GUARD 1
+#include "main.cpp"
+#include <new>
+#include <unity.h>
+#include <vector>
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void  __libc_free(void* ptr);
+
+    void* __real_malloc(size_t size) { return __libc_malloc(size); }
+    void* __real_calloc(size_t count, size_t size) { return __libc_calloc(count, size); }
+    void* __real_realloc(void* ptr, size_t size) { return __libc_realloc(ptr, size); }
+    void  __real_free(void* ptr) { __libc_free(ptr); }
+
+    void* malloc(size_t size) { return __wrap_malloc(size); }
+    void* calloc(size_t count, size_t size) { return __wrap_calloc(count, size); }
+    void* realloc(void* ptr, size_t size) { return __wrap_realloc(ptr, size); }
+    void  free(void* ptr) { __wrap_free(ptr); }
+}
+
+#else
+
+extern "C"
+{
+    void* __real_malloc(size_t size) { return std::malloc(size); }
+    void* __real_calloc(size_t count, size_t size) { return std::calloc(count, size); }
+    void* __real_realloc(void* ptr, size_t size) { return std::realloc(ptr, size); }
+    void  __real_free(void* ptr) { std::free(ptr); }
+}
+
+void* operator new(size_t size)
+{
+    if (void* ptr = __wrap_malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void  operator delete(void* ptr) noexcept { __wrap_free(ptr); }
+void  operator delete[](void* ptr) noexcept { __wrap_free(ptr); }
+void  operator delete(void* ptr, size_t) noexcept { __wrap_free(ptr); }
+void  operator delete[](void* ptr, size_t) noexcept { __wrap_free(ptr); }
+
+#endif
+
+// The newlib and IDF entry points only exist on the board, but the wrappers
+// refer to them
+
+extern "C"
+{
+    void* __real__malloc_r(_reent*, size_t size) { return __real_malloc(size); }
+    void* __real__calloc_r(_reent*, size_t count, size_t size) { return __real_calloc(count, size); }
+    void* __real__realloc_r(_reent*, void* ptr, size_t size) { return __real_realloc(ptr, size); }
+    void  __real__free_r(_reent*, void* ptr) { __real_free(ptr); }
+    void* __real_heap_caps_malloc(size_t size, uint32_t) { return __real_malloc(size); }
+    void  __real_heap_caps_free(void* ptr) { __real_free(ptr); }
+}
+
+void setUp() { g_HeapGuard.Reset(); }
+void tearDown() {}
+
+// Without this the other tests would pass with the guard disconnected
+
+void test_guard_catches_an_allocation()
+{
+    {
+        HEAP_GUARD_SCOPE(g_HeapGuard);
+        std::vector<uint32_t> scratch(16);
+        scratch[0] = 1;
+    }
+    TEST_ASSERT_EQUAL(2, g_HeapGuard.Count()); // The new and the delete
+
+    std::vector<uint32_t> unguarded(16);
+    TEST_ASSERT_EQUAL(2, g_HeapGuard.Count());
+}
+
+void test_every_effect_renders_without_the_heap()
+{
+    RunHeapCheck();
+    TEST_ASSERT_EQUAL(0, g_HeapGuard.Count());
+}
+
+void test_inputs_are_handled_without_the_heap()
+{
+    std::vector<InputEdge> trace;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const uint32_t us = i * 3000000;
+        trace.push_back({us, LEFT_TURN_PIN, LOW});
+        trace.push_back({us + 2000, RIGHT_TURN_PIN, LOW}); // Brake
+        trace.push_back({us + 1000000, LEFT_TURN_PIN, HIGH});
+        trace.push_back({us + 1002000, RIGHT_TURN_PIN, HIGH});
+        trace.push_back({us + 1500000, i & 1 ? BACKUP_PIN : EMERGENCY_PIN, LOW});
+        trace.push_back({us + 2500000, i & 1 ? BACKUP_PIN : EMERGENCY_PIN, HIGH});
+    }
+
+    g_HeapGuard.Reset();
+    const auto result = ReplayInputs(trace, false);
+
+    TEST_ASSERT_EQUAL(8, result.brakes);
+    TEST_ASSERT_EQUAL(0, g_HeapGuard.Count());
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_guard_catches_an_allocation);
+    RUN_TEST(test_every_effect_renders_without_the_heap);
+    RUN_TEST(test_inputs_are_handled_without_the_heap);
+    return UNITY_END();
+}
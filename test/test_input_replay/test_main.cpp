@@ -0,0 +1,236 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_input_replay)
+//
+// Description:
+//
+//   Replays a synthetic three-hour drive through the same debounce, brake
+//   inference and frame path as the board's R command.  The trace is far
+//   longer than the recorder's 1024-edge ring and crosses the 32-bit
+//   micros() wrap twice, so it covers what an exported trace or a long
+//   capture loaded on a host would.
+//
+//   Captures saved from the e command parse back through ParseInputEdge().
+//   To replay one of your own, point INPUT_CAPTURE at the saved serial log:
+//
+//     INPUT_CAPTURE=drive.log pio test -e native -f test_input_replay
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+// DriveTrace
+//
+// A drive as the IRQs would have recorded it: every 20 seconds either a
+// brake press (both bulb-sense lines falling a few ms apart, with contact
+// bounce, then released) or a turn signal flashing for a few cycles.
+
+struct DriveTrace
+{
+    std::vector<InputEdge> edges;
+    uint32_t               brakes = 0;
+};
+
+struct TimedEdge
+{
+    uint64_t us;
+    uint8_t  pin;
+    uint8_t  level;
+};
+
+static void AddBouncyEdge(std::vector<TimedEdge>& edges, uint64_t us, uint8_t pin, uint8_t level)
+{
+    edges.push_back({us, pin, static_cast<uint8_t>(!level)});
+    edges.push_back({us + 300, pin, level});
+    edges.push_back({us + 900, pin, static_cast<uint8_t>(!level)});
+    edges.push_back({us + 1500, pin, level});
+}
+
+static DriveTrace MakeDriveTrace(uint32_t hours)
+{
+    DriveTrace             trace;
+    std::vector<TimedEdge> timed;
+
+    for (uint32_t event = 0; event < hours * 180; event++)
+    {
+        const uint64_t us = event * 20000000ULL;
+        if (event % 3 != 2)
+        {
+            const uint32_t skewUs = (event * 1300) % 8000; // Left and right lamps a few ms apart
+            AddBouncyEdge(timed, us, LEFT_TURN_PIN, LOW);
+            AddBouncyEdge(timed, us + skewUs, RIGHT_TURN_PIN, LOW);
+            AddBouncyEdge(timed, us + 1500000, LEFT_TURN_PIN, HIGH);
+            AddBouncyEdge(timed, us + 1500000 + skewUs, RIGHT_TURN_PIN, HIGH);
+            trace.brakes++;
+        }
+        else
+        {
+            const uint8_t pin = event & 1 ? LEFT_TURN_PIN : RIGHT_TURN_PIN;
+            for (uint32_t flash = 0; flash < 5; flash++)
+            {
+                AddBouncyEdge(timed, us + flash * 760000, pin, LOW);
+                AddBouncyEdge(timed, us + flash * 760000 + 380000, pin, HIGH);
+            }
+        }
+    }
+
+    // In time order, then as the IRQs would have stamped them: 32-bit
+    // micros(), starting near the wrap so that it comes early
+
+    std::stable_sort(timed.begin(), timed.end(),
+                     [](const TimedEdge& a, const TimedEdge& b) { return a.us < b.us; });
+    for (const TimedEdge& edge : timed)
+        trace.edges.push_back({static_cast<uint32_t>(0xF0000000 + edge.us), edge.pin, edge.level});
+    return trace;
+}
+
+// LoadCapture
+//
+// Reads the @E lines out of a serial log, ignoring everything else in it
+
+static std::vector<InputEdge> LoadCapture(std::istream& log)
+{
+    std::vector<InputEdge> edges;
+    std::string            line;
+    InputEdge              edge;
+
+    while (std::getline(log, line))
+        if (ParseInputEdge(line.c_str(), edge))
+            edges.push_back(edge);
+    return edges;
+}
+
+// AsSerialLog
+//
+// The trace as the e command prints it, saved by a serial monitor that adds
+// timestamps and CRLFs, with other output interleaved
+
+static std::string AsSerialLog(const std::vector<InputEdge>& edges)
+{
+    std::ostringstream log;
+    char               line[48];
+
+    log << "12:00:00.001 > Lifetime: 14 boots\r\n";
+    log << "12:00:00.002 > @E begin " << edges.size() << "\r\n";
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        snprintf(line, sizeof(line), "@E %lu %u %u", (unsigned long)edges[i].timeUs,
+                 edges[i].pin, edges[i].level);
+        log << (i % 2 ? "12:00:00.003 > " : "") << line << "\r\n";
+        if (i % 100 == 0)
+            log << "@T 1 2 3 4\r\n";
+    }
+    log << "12:00:00.004 > @E end\r\n";
+    return log.str();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_long_trace_replays_every_edge_and_brake()
+{
+    const DriveTrace trace  = MakeDriveTrace(3);
+    const auto       result = ReplayInputs(trace.edges, false);
+
+    TEST_ASSERT_GREATER_THAN(1024, trace.edges.size());
+    TEST_ASSERT_EQUAL_UINT32(trace.edges.size(), result.edges);
+    TEST_ASSERT_EQUAL_UINT32(trace.brakes, result.brakes);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3 * 3600 * 1000 - 20000, result.virtualMs);
+
+    // A settled press lights within the debounce plus a frame or two
+
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(EdgeInputSource::DebounceMs + 2 * ReplayFramePeriodUs / 1000,
+                                     result.maxBrakeLatencyMs);
+    TEST_ASSERT_FALSE(g_InputReplayActive);
+    TEST_ASSERT_TRUE(g_InputSource == g_LiveInput);
+}
+
+void test_recorder_keeps_the_newest_edges()
+{
+    InputRecorder<1024> recorder;
+    for (uint32_t i = 0; i < 1500; i++)
+        recorder.Record(i & 1 ? LEFT_TURN_PIN : RIGHT_TURN_PIN, i & 1);
+
+    TEST_ASSERT_EQUAL_UINT32(1024, recorder.size());
+    TEST_ASSERT_EQUAL(LEFT_TURN_PIN, recorder[1023].pin); // Edge 1499
+    TEST_ASSERT_EQUAL(RIGHT_TURN_PIN, recorder[0].pin);   // Edge 476
+}
+
+void test_exported_capture_loads_and_replays()
+{
+    const DriveTrace   trace = MakeDriveTrace(1);
+    std::istringstream log(AsSerialLog(trace.edges));
+    const auto         edges = LoadCapture(log);
+
+    TEST_ASSERT_EQUAL_UINT32(trace.edges.size(), edges.size());
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(trace.edges[i].timeUs, edges[i].timeUs);
+        TEST_ASSERT_EQUAL(trace.edges[i].pin, edges[i].pin);
+        TEST_ASSERT_EQUAL(trace.edges[i].level, edges[i].level);
+    }
+
+    const auto result = ReplayInputs(edges, false);
+    TEST_ASSERT_EQUAL_UINT32(edges.size(), result.edges);
+    TEST_ASSERT_EQUAL_UINT32(trace.brakes, result.brakes);
+}
+
+void test_malformed_capture_lines_are_skipped()
+{
+    InputEdge edge{};
+
+    TEST_ASSERT_FALSE(ParseInputEdge("@E begin 1024", edge));
+    TEST_ASSERT_FALSE(ParseInputEdge("@E end", edge));
+    TEST_ASSERT_FALSE(ParseInputEdge("@E 1000 2", edge));
+    TEST_ASSERT_FALSE(ParseInputEdge("@E 1000 64 0", edge)); // Beyond the replay's pin levels
+    TEST_ASSERT_FALSE(ParseInputEdge("@E 1000 2 3", edge));
+    TEST_ASSERT_FALSE(ParseInputEdge("@E 1000 2 0 7", edge));
+    TEST_ASSERT_FALSE(ParseInputEdge("@T 1000 2 0", edge));
+
+    TEST_ASSERT_TRUE(ParseInputEdge("09:41:07.250 > @E 4294967295 4 1\r", edge));
+    TEST_ASSERT_EQUAL_UINT32(4294967295u, edge.timeUs);
+    TEST_ASSERT_EQUAL(RIGHT_TURN_PIN, edge.pin);
+    TEST_ASSERT_EQUAL(HIGH, edge.level);
+}
+
+// Replays the capture named by INPUT_CAPTURE, when there is one
+
+void test_capture_file_replays()
+{
+    const char* path = getenv("INPUT_CAPTURE");
+    if (!path)
+        TEST_IGNORE_MESSAGE("Set INPUT_CAPTURE to a saved serial log to replay it");
+
+    std::ifstream file(path);
+    TEST_ASSERT_TRUE_MESSAGE(file.good(), "Can't open INPUT_CAPTURE");
+
+    const auto edges = LoadCapture(file);
+    TEST_ASSERT_GREATER_THAN(0, edges.size());
+
+    const auto result = ReplayInputs(edges, false);
+    TEST_ASSERT_EQUAL_UINT32(edges.size(), result.edges);
+
+    printf("%s: %lu edges, %lu ms virtual, %lu brakes, max brake latency %lu ms\n", path,
+           (unsigned long)result.edges, (unsigned long)result.virtualMs,
+           (unsigned long)result.brakes, (unsigned long)result.maxBrakeLatencyMs);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_long_trace_replays_every_edge_and_brake);
+    RUN_TEST(test_recorder_keeps_the_newest_edges);
+    RUN_TEST(test_exported_capture_loads_and_replays);
+    RUN_TEST(test_malformed_capture_lines_are_skipped);
+    RUN_TEST(test_capture_file_replays);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_input_stress)
+//
+// Description:
+//
+//   The board's virtual stress run ('v') on the host: seeded schedules of
+//   bounce, brakes, brake-over-hazard and emergency toggles go through the
+//   replay debounce and the whole frame path.  Checks that every edge is
+//   seen, that brakes keep lighting as soon as their lamps settle however
+//   hard the inputs are hammered, and that a seed always gives the same run.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+static StressStats RunSchedule(uint32_t seed, uint32_t edgesPerSecond, uint32_t minutes)
+{
+    StressConfig config;
+    config.seed           = seed;
+    config.edgesPerSecond = edgesPerSecond;
+    config.durationMs     = minutes * 60000;
+
+    uint32_t wallMs = 0;
+    return StressVirtual(config, wallMs);
+}
+
+void test_every_edge_reaches_the_debounce()
+{
+    const StressStats stats = RunSchedule(7, 200, 10);
+
+    TEST_ASSERT_GREATER_THAN(0, stats.edges);
+    TEST_ASSERT_EQUAL_UINT32(stats.edges, stats.irqs);
+    TEST_ASSERT_GREATER_THAN(0, stats.inputChanges);
+    TEST_ASSERT_LESS_THAN(stats.edges, stats.inputChanges); // Bounce is filtered out
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(10 * 60000, stats.elapsedMs);
+}
+
+// A brake lights once both lamps have settled: the schedule drops the second
+// one up to 10 ms after the first and bounces it for up to 24 ms, then there
+// is the debounce, up to two frames before the brake is drawn and a ms of
+// rounding on the millisecond clock.  Far above 200 edges/s the glitches
+// keep the lamps from ever settling, so brakes are rightly rare there.
+
+constexpr uint32_t MaxBrakeLatencyMs =
+    10 + 24 + EdgeInputSource::DebounceMs + 2 * ReplayFramePeriodUs / 1000 + 1;
+
+void test_brakes_light_promptly_under_load()
+{
+    for (uint32_t rate : {StressSchedule::MinEdgesPerSecond, 50u, 200u})
+    {
+        const StressStats stats = RunSchedule(3, rate, 5);
+
+        TEST_ASSERT_GREATER_THAN(0, stats.brakes);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(MaxBrakeLatencyMs, stats.brakeLatencyMaxMs);
+    }
+}
+
+void test_a_seed_repeats_exactly()
+{
+    const StressStats first  = RunSchedule(42, 100, 5);
+    const StressStats second = RunSchedule(42, 100, 5);
+    const StressStats other  = RunSchedule(43, 100, 5);
+
+    TEST_ASSERT_EQUAL_UINT32(first.edges, second.edges);
+    TEST_ASSERT_EQUAL_UINT32(first.inputChanges, second.inputChanges);
+    TEST_ASSERT_EQUAL_UINT32(first.brakes, second.brakes);
+    TEST_ASSERT_EQUAL_UINT32(first.brakeLatencyTotalMs, second.brakeLatencyTotalMs);
+    TEST_ASSERT_EQUAL_UINT32(first.frames, second.frames);
+    TEST_ASSERT_TRUE(first.edges != other.edges || first.inputChanges != other.inputChanges);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_every_edge_reaches_the_debounce);
+    RUN_TEST(test_brakes_light_promptly_under_load);
+    RUN_TEST(test_a_seed_repeats_exactly);
+    return UNITY_END();
+}
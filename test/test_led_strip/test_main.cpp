@@ -0,0 +1,80 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_led_strip)
+//
+// Description:
+//
+//   The strip's output stage against the host FastLED: the drawing buffer
+//   goes out untouched, and brightness and color correction are FastLED's
+//   to apply with its temporal dithering left on.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+
+void setUp()
+{
+    g_Strip.Begin();
+    g_Strip.SetColorCorrection(CRGB(StripColorCorrection));
+    g_Strip.fillScreen(BLACK16);
+}
+
+void tearDown() {}
+
+void test_drawing_goes_out_as_drawn()
+{
+    g_Strip.drawPixel(size_t(3), CRGB(1, 2, 3));
+    g_Strip.ShowStrip();
+
+    TEST_ASSERT_TRUE(FastLED.controller().leds() == g_Strip.GetLEDBuffer());
+    TEST_ASSERT_EQUAL(g_Strip.GetLEDCount(), FastLED.controller().size());
+    TEST_ASSERT_TRUE(FastLED.controller().leds()[3] == CRGB(1, 2, 3));
+    TEST_ASSERT_EQUAL(BINARY_DITHER, FastLED.getDither());
+    TEST_ASSERT_TRUE(FastLED.getCorrection() == CRGB(UncorrectedColor));
+}
+
+void test_brightness_is_left_to_fastled()
+{
+    g_Strip.drawPixel(size_t(0), CRGB(255, 128, 1));
+    g_Strip.setBrightness(37);
+    g_Strip.ShowStrip();
+
+    TEST_ASSERT_EQUAL(37, FastLED.getBrightness());
+    TEST_ASSERT_TRUE(FastLED.controller().leds()[0] == CRGB(255, 128, 1));
+}
+
+void test_braking_frame_sets_the_limited_brightness()
+{
+    g_Braking.Begin();
+    processAndDisplayInputs();
+
+    TEST_ASSERT_GREATER_OR_EQUAL(MinBrakeBrightness, FastLED.getBrightness());
+    g_Braking.End();
+    StopAllEffects();
+}
+
+void test_correction_is_left_to_fastled()
+{
+    g_Strip.drawPixel(size_t(5), CRGB(200, 100, 50));
+    g_Strip.SetColorCorrection(CRGB(TypicalLEDStrip));
+    g_Strip.ShowStrip();
+
+    TEST_ASSERT_TRUE(FastLED.getCorrection() == CRGB(TypicalLEDStrip));
+    TEST_ASSERT_TRUE(FastLED.controller().leds() == g_Strip.GetLEDBuffer());
+    TEST_ASSERT_TRUE(FastLED.controller().leds()[5] == CRGB(200, 100, 50));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_drawing_goes_out_as_drawn);
+    RUN_TEST(test_brightness_is_left_to_fastled);
+    RUN_TEST(test_braking_frame_sets_the_limited_brightness);
+    RUN_TEST(test_correction_is_left_to_fastled);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+//+--------------------------------------------------------------------------
+//
+// ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+//
+// File:        test_main.cpp (test_lifetime_stats)
+//
+// Description:
+//
+//   Lifetime statistics on the host: a long gap between frames, as after
+//   light sleep, isn't counted as on-time while ordinary frames are, the
+//   totals survive a save and reload, a year of the flush policy wears the
+//   simulated NVS no more than LifetimeStats.h says it does, and a stall
+//   kept through a watchdog reset is counted on the next boot.
+//
+// History:     Oct-18-2026   Davepl      Created
+//
+//---------------------------------------------------------------------------
+
+#include "main.cpp"
+#include <unity.h>
+
+constexpr size_t BackupIndex = 4; // g_Backup's place in g_AllEffects
+
+void setUp()
+{
+    for (auto* effect : g_AllEffects)
+        effect->End();
+}
+
+void tearDown() {}
+
+void test_a_gap_between_frames_is_not_on_time()
+{
+    g_LifetimeStats.Begin();
+    const uint32_t before = g_LifetimeStats.GetTotals().effectOnSeconds[BackupIndex];
+
+    g_Backup.Begin();
+    g_LifetimeFrameMs = millis() - 60 * 60 * 1000; // An hour asleep
+    RecordLifetimeStats();
+
+    TEST_ASSERT_EQUAL(before, g_LifetimeStats.GetTotals().effectOnSeconds[BackupIndex]);
+}
+
+void test_frames_add_up_to_on_time()
+{
+    g_LifetimeStats.Begin();
+    const uint32_t before = g_LifetimeStats.GetTotals().effectOnSeconds[BackupIndex];
+
+    g_Backup.Begin();
+    RestartLifetimeClock();
+    const uint32_t startMs = millis();
+    while (millis() - startMs < 1200)
+    {
+        delay(FrameDeadlineUs / 1000);
+        RecordLifetimeStats();
+    }
+
+    TEST_ASSERT_EQUAL(before + 1, g_LifetimeStats.GetTotals().effectOnSeconds[BackupIndex]);
+}
+
+void test_totals_survive_a_reload()
+{
+    SimulatedNvsStorage storage;
+    {
+        LifetimeStats<1> stats(storage);
+        stats.Begin();
+        stats.RecordBrake(35);
+        stats.RecordFrame(1, 2500);
+        TEST_ASSERT_TRUE(stats.Flush(0, LifetimeStats<1>::SleepFlushIntervalMs));
+        TEST_ASSERT_FALSE(stats.Flush(1000, LifetimeStats<1>::SleepFlushIntervalMs));
+    }
+
+    LifetimeStats<1> reloaded(storage);
+    TEST_ASSERT_TRUE(reloaded.Begin());
+    const LifetimeCounters totals = reloaded.GetTotals();
+    TEST_ASSERT_EQUAL(2, totals.boots);
+    TEST_ASSERT_EQUAL(1, totals.brakes);
+    TEST_ASSERT_EQUAL(35, totals.maxBrakeLatencyMs);
+    TEST_ASSERT_EQUAL(2, totals.effectOnSeconds[0]);
+    TEST_ASSERT_EQUAL(1, totals.flushes);
+}
+
+// A sleep a minute for a year is the worst case LifetimeStats.h works out:
+// about 4,200 erases of the busiest page, so over 20 years of endurance
+
+void test_a_year_of_saves_stays_within_endurance()
+{
+    const uint32_t everyMinute = SimulateLifetimeWear(365, 24 * 60, false);
+    TEST_ASSERT_INT_WITHIN(200, 4200, everyMinute);
+    TEST_ASSERT_LESS_THAN(SimulatedNvsStorage::EraseEndurance, everyMinute * 20);
+
+    const uint32_t everyQuarterHour = SimulateLifetimeWear(365, 24 * 4, false);
+    TEST_ASSERT_LESS_THAN(everyMinute, everyQuarterHour * 14);
+}
+
+void test_a_stall_is_counted_after_the_watchdog_reset()
+{
+    g_LifetimeStats.Begin();
+    ReportLastStall(); // Starts the record over
+    const LifetimeCounters before = g_LifetimeStats.GetTotals();
+
+    g_FrameMonitor.BeginFrame(42);
+    g_FrameMonitor.BeginPhase(FramePhase::Show);
+    delay(FrameStallUs / 1000 + 10);
+    CheckForFrameStall();
+    CheckForFrameStall(); // Once per stuck frame
+    g_FrameMonitor.EndFrame();
+
+    TEST_ASSERT_EQUAL(1, g_StallRecord.count);
+    TEST_ASSERT_EQUAL(42, g_StallRecord.frame);
+    TEST_ASSERT_EQUAL(static_cast<uint32_t>(FramePhase::Show), g_StallRecord.phase);
+
+    // What's left in RTC memory at the next boot
+    g_HostResetReason = ESP_RST_TASK_WDT;
+    ReportLastStall();
+    g_HostResetReason = ESP_RST_POWERON;
+
+    const LifetimeCounters after = g_LifetimeStats.GetTotals();
+    TEST_ASSERT_EQUAL(before.stalls + 1, after.stalls);
+    TEST_ASSERT_EQUAL(before.stallResets + 1, after.stallResets);
+    TEST_ASSERT_EQUAL(0, g_StallRecord.count);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_a_gap_between_frames_is_not_on_time);
+    RUN_TEST(test_frames_add_up_to_on_time);
+    RUN_TEST(test_totals_survive_a_reload);
+    RUN_TEST(test_a_year_of_saves_stays_within_endurance);
+    RUN_TEST(test_a_stall_is_counted_after_the_watchdog_reset);
+    return UNITY_END();
+}
@@ -0,0 +1,89 @@
+#
+# ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+#
+# footprint.py
+#
+# PlatformIO post-build script (see extra_scripts in platformio.ini) that
+# reports how much static RAM, IRAM and flash each translation unit asks for,
+# so we can watch the headroom as effects are added.  After every link it
+# runs the toolchain's size tool over the object files in the build
+# directory and buckets their sections:
+#
+#   RAM    .data, .bss, .dram (and their small-data variants)
+#   IRAM   .iram (IRAM_ATTR code and anything else pinned to instruction RAM)
+#   Flash  .text, .literal, .rodata, .flash - code and constant tables
+#
+# Our own sources are listed one per line; libraries and the framework are
+# rolled up by directory.  Figures are per object before the linker discards
+# unused sections, so they overstate library usage; the linked totals are in
+# PlatformIO's own RAM/Flash summary.  .data also takes flash for its initial
+# values, which isn't counted here.
+
+import os
+import subprocess
+
+Import("env")  # noqa: F821 - provided by SCons
+
+CATEGORIES = (
+    ("iram", (".iram",)),
+    ("ram", (".data", ".bss", ".dram", ".sdata", ".sbss", ".noinit")),
+    ("flash", (".text", ".literal", ".rodata", ".flash", ".irom")),
+)
+
+
+def categorize(section):
+    for category, prefixes in CATEGORIES:
+        if section.startswith(prefixes):
+            return category
+    return None
+
+
+def object_footprint(size_tool, path):
+    totals = {"ram": 0, "iram": 0, "flash": 0}
+    output = subprocess.run([size_tool, "-A", path], capture_output=True, text=True).stdout
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) < 2 or not fields[1].isdigit():
+            continue
+        category = categorize(fields[0])
+        if category:
+            totals[category] += int(fields[1])
+    return totals
+
+
+def report(target, source, env):
+    size_tool = env.subst("$SIZETOOL")
+    build_dir = env.subst("$BUILD_DIR")
+    src_dir = os.path.join(build_dir, "src")
+
+    rows = {}
+    for root, _, files in os.walk(build_dir):
+        for name in files:
+            if not name.endswith(".o"):
+                continue
+            path = os.path.join(root, name)
+            if os.path.dirname(path) == src_dir:
+                label = name[:-2]
+            else:
+                # lib_deps build under lib<hash>/<Library>/, the framework
+                # under its own top-level directory
+                parts = os.path.relpath(root, build_dir).split(os.sep)
+                depth = 2 if parts[0].startswith("lib") and len(parts) > 1 else 1
+                label = "/".join(parts[:depth]) + "/*"
+            totals = rows.setdefault(label, {"ram": 0, "iram": 0, "flash": 0})
+            for category, size in object_footprint(size_tool, path).items():
+                totals[category] += size
+
+    own = sorted(label for label in rows if not label.endswith("/*"))
+    libraries = sorted(label for label in rows if label.endswith("/*"))
+
+    print()
+    print("Static footprint per translation unit (bytes, before section GC)")
+    print("%-40s %9s %9s %9s" % ("", "RAM", "IRAM", "Flash"))
+    for label in own + libraries:
+        totals = rows[label]
+        print("%-40s %9d %9d %9d" % (label, totals["ram"], totals["iram"], totals["flash"]))
+    print()
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)  # noqa: F821
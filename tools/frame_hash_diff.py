@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+#
+# ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+#
+# frame_hash_diff.py
+#
+# Compares two frame hash sweeps captured from the serial port (the output of
+# the 'h' or 'H' serial commands, see RunFrameSweep in main.cpp), typically
+# one from before a render-path change and one from after.  'h' captures hold
+# one digest per case, so only the cases that changed can be reported; 'H'
+# captures hold every frame's hash and the changed pixels, so the tool lists
+# the frames whose hash differs and which pixels moved in them.
+#
+# Usage:  frame_hash_diff.py before.txt after.txt
+#
+# Exits non-zero if any frame differs.
+
+import sys
+
+MAX_FRAMES_SHOWN = 10
+MAX_PIXELS_SHOWN = 16
+
+
+def load(path):
+    hashes = {}
+    pixels = {}
+    digests = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 4 and fields[0] == "@H":
+                hashes[(fields[1], int(fields[2]))] = fields[3]
+            elif len(fields) == 4 and fields[0] == "@P":
+                pixels[(fields[1], int(fields[2]))] = fields[3]
+            elif len(fields) == 4 and fields[0] == "@D":
+                digests[fields[1]] = (int(fields[2]), fields[3])
+    return hashes, pixels, digests
+
+
+def pixels_at(pixels, key):
+    # Pixel lines are only written when a frame changes, so the frame at any
+    # time is the most recent dump at or before it in the same case.
+    name, t = key
+    times = [pt for (pn, pt) in pixels if pn == name and pt <= t]
+    if not times:
+        return None
+    data = pixels[(name, max(times))]
+    return [data[i:i + 6] for i in range(0, len(data), 6)]
+
+
+def compare_digests(before, after):
+    if not before or not after:
+        print("both captures need @D or @H lines", file=sys.stderr)
+        return 2
+
+    differ = 0
+    for case in sorted(set(before) | set(after)):
+        a = before.get(case)
+        b = after.get(case)
+        if a == b:
+            status = "same"
+        elif a is None or b is None:
+            status = "only in %s" % (sys.argv[1] if b is None else sys.argv[2])
+        else:
+            status = "%s -> %s" % (a[1], b[1])
+        differ += a != b
+        print("%-16s %5d frames, %s" % (case, (a or b)[0], status))
+
+    if differ:
+        print("capture both with 'H' to see which frames and pixels moved")
+    return 1 if differ else 0
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: frame_hash_diff.py before.txt after.txt", file=sys.stderr)
+        return 2
+
+    before, before_pixels, before_digests = load(sys.argv[1])
+    after, after_pixels, after_digests = load(sys.argv[2])
+
+    if not before or not after:
+        return compare_digests(before_digests, after_digests)
+
+    missing = sorted(set(before) ^ set(after))
+    changed = sorted(k for k in set(before) & set(after) if before[k] != after[k])
+
+    for key in missing:
+        print("%s @ %d ms: only in %s" % (key[0], key[1],
+                                         sys.argv[1] if key in before else sys.argv[2]))
+
+    for n, key in enumerate(changed):
+        if n == MAX_FRAMES_SHOWN:
+            print("... %d more differing frames" % (len(changed) - n))
+            break
+        print("%s @ %d ms: %s -> %s" % (key[0], key[1], before[key], after[key]))
+
+        a = pixels_at(before_pixels, key)
+        b = pixels_at(after_pixels, key)
+        if a is None or b is None:
+            continue
+        diffs = [i for i in range(min(len(a), len(b))) if a[i] != b[i]]
+        for i in diffs[:MAX_PIXELS_SHOWN]:
+            print("    pixel %3d: #%s -> #%s" % (i, a[i], b[i]))
+        if len(diffs) > MAX_PIXELS_SHOWN:
+            print("    ... %d more pixels" % (len(diffs) - MAX_PIXELS_SHOWN))
+
+    cases = sorted({k[0] for k in before})
+    for case in cases:
+        total = sum(1 for k in before if k[0] == case)
+        bad = sum(1 for k in changed if k[0] == case)
+        print("%-16s %5d frames, %5d differ" % (case, total, bad))
+
+    return 1 if changed or missing else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
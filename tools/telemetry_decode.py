@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+#
+# telemetry_decode.py
+#
+# Turns a serial capture from the board into CSV.  Every "@T <hex>" line is a
+# TelemetryRecord (see src/Telemetry.h); anything else in the capture is
+# ordinary text logging and is skipped.
+#
+# Usage:  telemetry_decode.py capture.txt > telemetry.csv
+#         pio device monitor | telemetry_decode.py > telemetry.csv
+
+import csv
+import struct
+import sys
+
+# Must match TelemetryRecord in src/Telemetry.h
+RECORD = struct.Struct("<BBBBIII4H")
+
+KINDS = ["Frame", "DemoMode", "DemoStep", "Sleep", "Wake", "Dropped", "Overrun", "Stall"]
+
+# Bit order of the input mask (InputBit in main.cpp) and the active mask
+# (g_AllEffects in main.cpp)
+INPUTS = ["L", "R", "Bk", "E", "Demo"]
+EFFECTS = ["Emergency", "Braking", "LeftTurn", "RightTurn", "Backup"]
+
+DEMO_STEPS = ["Left", "Right", "Brake", "Hazard", "Emergency", "Backup"]
+
+OVERRUN_CAUSES = ["input", "render", "show"]
+
+# FramePhase in src/FrameMonitor.h
+FRAME_PHASES = ["input", "render", "show"]
+
+
+def bits(mask, names):
+    return "|".join(name for i, name in enumerate(names) if mask & (1 << i))
+
+
+def describe(kind, detail):
+    if kind == "DemoMode":
+        return "on" if detail else "off"
+    if kind == "DemoStep":
+        return DEMO_STEPS[detail] if detail < len(DEMO_STEPS) else str(detail)
+    if kind == "Wake":
+        return "cause=%d" % detail
+    if kind == "Overrun":
+        return OVERRUN_CAUSES[detail] if detail < len(OVERRUN_CAUSES) else str(detail)
+    if kind == "Stall":
+        return FRAME_PHASES[detail] if detail < len(FRAME_PHASES) else str(detail)
+    return ""
+
+
+def decode(lines, out):
+    writer = csv.writer(out)
+    writer.writerow(["time_ms", "frame", "kind", "detail", "value", "inputs", "active",
+                     "irq_l", "irq_r", "irq_bk", "irq_e"])
+    bad = 0
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("@T "):
+            continue
+        try:
+            raw = bytes.fromhex(line[3:])
+            kind, detail, inputs, active, time_ms, frame, value, *irqs = RECORD.unpack(raw)
+        except (ValueError, struct.error):
+            bad += 1
+            continue
+
+        kind = KINDS[kind] if kind < len(KINDS) else str(kind)
+        writer.writerow([time_ms, frame, kind, describe(kind, detail), value,
+                         bits(inputs, INPUTS), bits(active, EFFECTS), *irqs])
+    if bad:
+        print("Skipped %d corrupt telemetry lines" % bad, file=sys.stderr)
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], errors="replace") as f:
+            decode(f, sys.stdout)
+    else:
+        decode(sys.stdin, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+#
+# ThirdBrakeLight - (c) 2019 Dave Plummer.  All Rights Reserved.
+#
+# trace_to_chrome.py
+#
+# Converts a timeline trace dumped over serial (the "@X" lines written by
+# TraceBuffer::Dump in src/Trace.h) into Chrome trace-format JSON.  Open the
+# result in chrome://tracing or https://ui.perfetto.dev.
+#
+# Each core becomes a process and each track ("render", "ui", "irq", ...)
+# a thread within it, so you can see the tasks overlap and preempt each other
+# and where the gaps between frames are.
+#
+# Usage:  trace_to_chrome.py capture.txt > trace.json
+
+import json
+import sys
+
+
+def convert(lines):
+    events = []
+    tracks = {}
+    for line in lines:
+        fields = line.strip().split(" ", 4)
+        if len(fields) != 5 or fields[0] != "@X":
+            continue
+        _, ts, phase, core, name = fields
+        track, _, event = name.partition(":")
+        tid = tracks.setdefault(track, len(tracks))
+
+        e = {"name": event or track, "ph": phase, "ts": int(ts), "pid": int(core), "tid": tid}
+        if phase == "i":
+            e["s"] = "t"
+        events.append(e)
+
+    events.sort(key=lambda e: e["ts"])
+
+    cores = sorted({e["pid"] for e in events})
+    for core in cores:
+        events.append({"name": "process_name", "ph": "M", "pid": core,
+                       "args": {"name": "Core %d" % core}})
+        for track, tid in tracks.items():
+            events.append({"name": "thread_name", "ph": "M", "pid": core, "tid": tid,
+                           "args": {"name": track}})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], errors="replace") as f:
+            trace = convert(f)
+    else:
+        trace = convert(sys.stdin)
+    json.dump(trace, sys.stdout, indent=1)
+
+
+if __name__ == "__main__":
+    main()